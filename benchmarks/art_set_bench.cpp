@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <malloc.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../containers/art_set.hpp"
+#include "../containers/set.hpp"
+
+
+// bytes currently handed out by malloc, includes the per-allocation overhead
+// and the large blocks malloc serves with mmap
+static size_t heap_in_use()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+static double seconds_since( std::chrono::high_resolution_clock::time_point start )
+{
+    std::chrono::duration<double> dur = std::chrono::high_resolution_clock::now() - start;
+    return dur.count();
+}
+
+static bool starts_with( const std::string& key, const std::string& prefix )
+{
+    return key.compare(0, prefix.size(), prefix) == 0;
+}
+
+// keys, lookups of all of them shuffled and of as many absent ones, an ordered
+// pass and a scan of the keys under each of the prefixes
+template< class Set, class PrefixScan >
+static void run( const char* name, const std::vector<std::string>& keys, const std::vector<std::string>& hits,
+                 const std::vector<std::string>& misses, const std::vector<std::string>& prefixes, PrefixScan scan )
+{
+    size_t before = heap_in_use();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Set s;
+    for (const std::string& key : keys) s.insert(key);
+
+    double insert = seconds_since(start);
+    size_t bytes = heap_in_use() - before;
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t found = 0;
+    for (const std::string& key : hits) found += s.contains(key);
+    double hit = seconds_since(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (const std::string& key : misses) found += s.contains(key);
+    double miss = seconds_since(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t length = 0;
+    for (const std::string& key : s) length += key.size();
+    double iterate = seconds_since(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t scanned = 0;
+    for (const std::string& prefix : prefixes) scanned += scan(s, prefix);
+    double prefix = seconds_since(start);
+
+    std::printf("%s\n", name);
+    std::printf("  memory:      %.1f bytes per key\n", static_cast<double>(bytes) / static_cast<double>(s.size()));
+    std::printf("  insert:      %.4f s\n", insert);
+    std::printf("  find hits:   %.4f s\n", hit);
+    std::printf("  find misses: %.4f s (%zu found)\n", miss, found);
+    std::printf("  iterate:     %.4f s (%zu bytes)\n", iterate, length);
+    std::printf("  prefixes:    %.4f s (%zu keys)\n", prefix, scanned);
+}
+
+int main()
+{
+    // 1M URLs sharing scheme, host and section prefixes
+    std::mt19937 rng(50);
+    auto url = [&rng] {
+        return "https://www.shop-" + std::to_string(rng() % 200) + ".example.com/catalogue/section-" + std::to_string(rng() % 50) +
+               "/item/" + std::to_string(rng() % 1000000);
+    };
+
+    std::vector<std::string> keys(1000000);
+    for (std::string& key : keys) key = url();
+
+    std::vector<std::string> hits(keys);
+    std::shuffle(hits.begin(), hits.end(), rng);
+    std::vector<std::string> misses(1000000);
+    for (std::string& key : misses) key = url() + "/reviews";
+
+    std::vector<std::string> prefixes(2000);
+    for (std::string& prefix : prefixes)
+        prefix = "https://www.shop-" + std::to_string(rng() % 200) + ".example.com/catalogue/section-" + std::to_string(rng() % 50) + "/";
+
+    run<art_set<std::string>>("art_set<std::string>", keys, hits, misses, prefixes, []( const art_set<std::string>& s, const std::string& prefix ) {
+        size_t count = 0;
+        s.for_each_prefix(prefix, [&count]( const std::string& ) { ++count; });
+        return count;
+    });
+
+    run<set<std::string>>("set<std::string>", keys, hits, misses, prefixes, []( const set<std::string>& s, const std::string& prefix ) {
+        size_t count = 0;
+        for (auto it = s.lower_bound(prefix); it != s.end() && starts_with(*it, prefix); ++it) ++count;
+        return count;
+    });
+}
@@ -0,0 +1,103 @@
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "../containers/cache.hpp"
+
+
+// counts the caches' allocations so the hit path can be checked for zero
+static size_t g_allocations = 0;
+
+template< class T >
+struct counting_allocator
+{
+    using value_type = T;
+
+    counting_allocator() = default;
+    template< class U >
+    counting_allocator( const counting_allocator<U>& ) noexcept {}
+
+    T* allocate( size_t n )
+    {
+        ++g_allocations;
+        return std::allocator<T>().allocate(n);
+    }
+    void deallocate( T* p, size_t n ) noexcept { std::allocator<T>().deallocate(p, n); }
+
+    friend bool operator == ( const counting_allocator&, const counting_allocator& ) noexcept { return true; }
+};
+
+template< class Key, class T >
+using counted_lru_cache = lru_cache<Key, T, std::hash<Key>, std::equal_to<Key>, counting_allocator<std::pair<const Key, T>>>;
+template< class Key, class T >
+using counted_lfu_cache = lfu_cache<Key, T, std::hash<Key>, std::equal_to<Key>, counting_allocator<std::pair<const Key, T>>>;
+
+
+// zipf distributed keys in [0, n), the usual shape of cache traffic
+static std::vector<int> zipf_keys( size_t count, int n, double skew, unsigned seed )
+{
+    std::vector<double> cdf(n);
+    double sum = 0;
+    for (int i = 0; i < n; ++i) cdf[i] = (sum += 1.0 / std::pow(i + 1, skew));
+    for (auto& c : cdf) c /= sum;
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    std::vector<int> keys(count);
+    for (auto& k : keys)
+        k = static_cast<int>(std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin());
+    return keys;
+}
+
+template< class Cache >
+static void run( const char* name, size_t capacity, const std::vector<int>& keys )
+{
+    Cache cache(capacity);
+    size_t hits = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int key : keys)
+    {
+        if (cache.get(key) != nullptr) ++hits;
+        else cache.put(key, key);
+    }
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> dur = stop - start;
+
+    // replay only the resident keys, every one of them is a hit
+    std::vector<int> resident;
+    for (int key : keys) if (cache.contains(key)) resident.push_back(key);
+
+    size_t before = g_allocations;
+    for (int key : resident) cache.get(key);
+    size_t hit_allocations = g_allocations - before;
+
+    std::printf("%s capacity %zu: hit rate %.3f, %.2f Mops/s, allocations on hit path %zu\n",
+        name, capacity, double(hits) / keys.size(), keys.size() / dur.count() / 1e6, hit_allocations);
+}
+
+int main()
+{
+    const size_t operations = 2000000;
+    const int universe = 1000000;
+
+    for (double skew : { 0.8, 1.0, 1.2 })
+    {
+        std::vector<int> keys = zipf_keys(operations, universe, skew, 42);
+        std::printf("zipf skew %.1f, %zu operations over %d keys\n", skew, operations, universe);
+
+        for (size_t capacity : { 1000ul, 10000ul, 100000ul })
+        {
+            run<counted_lru_cache<int, int>>("lru_cache", capacity, keys);
+            run<counted_lfu_cache<int, int>>("lfu_cache", capacity, keys);
+        }
+        std::printf(" \n");
+    }
+
+    return 0;
+}
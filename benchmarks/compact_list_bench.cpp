@@ -0,0 +1,55 @@
+#include <chrono>
+#include <cstdio>
+#include <list>
+#include <malloc.h>
+
+#include "../containers/compact_list.hpp"
+#include "../containers/list.hpp"
+
+
+// bytes currently handed out by malloc, includes the per-allocation overhead
+// and the large blocks malloc serves with mmap
+static size_t heap_in_use()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+template< class List >
+static void run( const char* name, size_t count )
+{
+    size_t before = heap_in_use();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    {
+        List l;
+        for (size_t i = 0; i < count; ++i) l.push_back(static_cast<int>(i));
+
+        auto filled = std::chrono::high_resolution_clock::now();
+        size_t bytes = heap_in_use() - before;
+
+        long long sum = 0;
+        for (int x : l) sum += x;
+
+        auto traversed = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> fill = filled - start;
+        std::chrono::duration<double> walk = traversed - filled;
+
+        std::printf("%s: %.1f bytes per element, push_back %.4f s, traversal %.4f s (sum %lld)\n",
+            name, double(bytes) / count, fill.count(), walk.count(), sum);
+    }
+}
+
+int main()
+{
+    for (size_t count : { 1000000ul, 10000000ul })
+    {
+        std::printf("%zu ints\n", count);
+        run<std::list<int>>("std::list", count);
+        run<list<int>>("list", count);
+        run<compact_list<int>>("compact_list", count);
+        std::printf(" \n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+#include <chrono>
+#include <cstdio>
+#include <malloc.h>
+#include <random>
+#include <set>
+#include <vector>
+
+#include "../containers/btree_set.hpp"
+#include "../containers/compact_set.hpp"
+#include "../containers/set.hpp"
+
+
+// bytes currently handed out by malloc, includes the per-allocation overhead
+// and the large blocks malloc serves with mmap
+static size_t heap_in_use()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+template< class Set >
+static void run( const char* name, const std::vector<int>& keys, const std::vector<int>& probes, bool shrink = false )
+{
+    size_t before = heap_in_use();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    {
+        Set s;
+        for (int key : keys) s.insert(key);
+        if constexpr (requires { s.shrink_to_fit(); })
+            if (shrink) s.shrink_to_fit();
+
+        auto filled = std::chrono::high_resolution_clock::now();
+        size_t bytes = heap_in_use() - before;
+
+        size_t found = 0;
+        for (int key : probes) found += s.find(key) != s.end();
+
+        auto looked_up = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> fill = filled - start;
+        std::chrono::duration<double> lookup = looked_up - filled;
+
+        std::printf("%s: %.1f bytes per key, insert %.4f s, find %.4f s (%zu found)\n",
+            name, double(bytes) / s.size(), fill.count(), lookup.count(), found);
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(42);
+    for (size_t count : { 1000000ul, 4000000ul })
+    {
+        std::vector<int> keys(count), probes(count);
+        for (int& key : keys) key = static_cast<int>(rng() % (2 * count));
+        for (int& key : probes) key = static_cast<int>(rng() % (2 * count));
+
+        std::printf("%zu random ints\n", count);
+        run<std::set<int>>("std::set", keys, probes);
+        run<set<int>>("set", keys, probes);
+        run<compact_set<int>>("compact_set", keys, probes);
+        run<compact_set<int>>("compact_set shrunk", keys, probes, true);
+        run<btree_set<int>>("btree_set", keys, probes);
+        std::printf(" \n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../containers/concurrent_set.hpp"
+#include "../containers/set.hpp"
+
+
+// the baseline concurrent_set replaces
+class locked_set
+{
+public:
+    bool contains( std::uint64_t key )
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_keys.find(key) != m_keys.end();
+    }
+
+    bool insert( std::uint64_t key )
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_keys.insert(key).second;
+    }
+
+    size_t erase( std::uint64_t key )
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_keys.erase(key);
+    }
+
+private:
+    std::mutex m_mutex;
+    set<std::uint64_t> m_keys;
+};
+
+// key_range / 2 keys are present up front, writes are half inserts and half erases
+template< class Set >
+static void run( const char* name, int threads, int read_percent, long per_thread, std::uint64_t key_range )
+{
+    Set keys;
+    for (std::uint64_t key = 0; key < key_range; key += 2) keys.insert(key);
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&keys, t, read_percent, per_thread, key_range] {
+            std::mt19937_64 rng(t + 1);
+            for (long i = 0; i < per_thread; ++i)
+            {
+                std::uint64_t r = rng();
+                std::uint64_t key = (r >> 8) % key_range;
+                int dice = static_cast<int>(r % 100);
+
+                if (dice < read_percent) keys.contains(key);
+                else if (dice & 1) keys.insert(key);
+                else keys.erase(key);
+            }
+        });
+
+    for (auto& w : workers) w.join();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> dur = stop - start;
+
+    std::printf("%s %d thr, %d/%d: %.2f Mops/s\n", name, threads, read_percent, 100 - read_percent,
+        per_thread * threads / dur.count() / 1e6);
+}
+
+int main()
+{
+    const long per_thread = 500000;
+    const std::uint64_t key_range = 1 << 20;
+
+    std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    for (int read_percent : { 90, 50, 10 })
+    {
+        for (int threads : { 1, 2, 4, 8 })
+        {
+            run<locked_set>("set+mutex", threads, read_percent, per_thread, key_range);
+            run<concurrent_set<std::uint64_t>>("concurrent_set", threads, read_percent, per_thread, key_range);
+        }
+        std::printf(" \n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,68 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../containers/filtered_set.hpp"
+#include "../containers/set.hpp"
+
+
+// 1M lookups against 1M keys, hit_percent of them for keys that are present
+static std::vector<int> make_probes( const std::vector<int>& keys, int hit_percent, std::mt19937& rng )
+{
+    std::vector<int> probes(1000000);
+    for (int& probe : probes)
+    {
+        // keys are even, odd probes always miss
+        if (static_cast<int>(rng() % 100) < hit_percent) probe = keys[rng() % keys.size()];
+        else probe = static_cast<int>(rng() % 0x7ffffffe) | 1;
+    }
+    return probes;
+}
+
+template< class Set >
+static double find_time( const Set& s, const std::vector<int>& probes, size_t& found )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    found = 0;
+    for (int key : probes) found += s.find(key) != s.end();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+int main()
+{
+    std::mt19937 rng(7);
+    std::vector<int> keys(1000000);
+    for (int& key : keys) key = static_cast<int>(rng() % 0x3fffffff) * 2;
+
+    set<int> plain(keys.begin(), keys.end());
+
+    for (int hit_percent : { 1, 10, 50 })
+    {
+        std::vector<int> probes = make_probes(keys, hit_percent, rng);
+        size_t found;
+
+        std::printf("%d%% hits\n", hit_percent);
+        double seconds = find_time(plain, probes, found);
+        std::printf("  set: %.4f s, %zu found\n", seconds, found);
+
+        for (double rate : { 0.01, 0.001 })
+        {
+            filtered_set<int> filtered(keys.size(), rate);
+            for (int key : keys) filtered.insert(key);
+
+            seconds = find_time(filtered, probes, found);
+            const auto& stats = filtered.stats();
+            std::printf("  filtered_set p=%g (%.1f bits per key, k=%u): %.4f s, %zu found, hits %zu, misses %zu, rejects %zu, false positives %.3f%%\n",
+                rate, double(filtered.filter().bit_count()) / filtered.size(), filtered.filter().hash_count(), seconds, found,
+                stats.hits, stats.misses, stats.filter_rejects, 100.0 * stats.misses / (stats.misses + stats.filter_rejects));
+        }
+        std::printf(" \n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "../containers/set.hpp"
+
+
+template< class Fn >
+static double time_it( Fn fn )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    fn();
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+int main()
+{
+    // 1M time ranges over a day in milliseconds, most short and a few long
+    std::mt19937_64 rng(49);
+    const long long day = 86400000;
+    std::vector<interval<long long>> ranges(1000000);
+    for (auto& range : ranges)
+    {
+        long long length = rng() % 64 == 0 ? static_cast<long long>(rng() % 3600000) : static_cast<long long>(rng() % 60000);
+        range.lo = static_cast<long long>(rng() % day);
+        range.hi = range.lo + length;
+    }
+
+    std::vector<long long> queries(50);
+    for (long long& query : queries) query = static_cast<long long>(rng() % day);
+
+    set<interval<long long>> plain;
+    interval_set<long long> tree;
+    double plain_insert = time_it([&] { for (const auto& range : ranges) plain.insert(range); });
+    double tree_insert = time_it([&] { for (const auto& range : ranges) tree.insert(range); });
+    std::printf("insert 1M ranges\n");
+    std::printf("  set:          %.4f s\n", plain_insert);
+    std::printf("  interval_set: %.4f s\n", tree_insert);
+
+    // overlaps with a 10 second window at each query point
+    long long scan_found = 0, tree_found = 0;
+    double scan_overlap = time_it([&] {
+        for (long long query : queries)
+            for (const auto& range : plain)
+                if (!(range.hi < query) && !(query + 10000 < range.lo)) ++scan_found;
+    });
+    double tree_overlap = time_it([&] {
+        for (long long query : queries)
+            tree.for_each_overlapping(query, query + 10000, [&]( const interval<long long>& ) { ++tree_found; });
+    });
+    std::printf("%zu overlap queries\n", queries.size());
+    std::printf("  linear scan:  %.4f s (%lld)\n", scan_overlap, scan_found);
+    std::printf("  interval_set: %.4f s (%lld)\n", tree_overlap, tree_found);
+
+    scan_found = tree_found = 0;
+    double scan_stab = time_it([&] {
+        for (long long query : queries)
+            for (const auto& range : plain)
+                if (range.lo <= query && query <= range.hi) ++scan_found;
+    });
+    double tree_stab = time_it([&] {
+        for (long long query : queries)
+            tree.for_each_stabbing(query, [&]( const interval<long long>& ) { ++tree_found; });
+    });
+    std::printf("%zu stabbing queries\n", queries.size());
+    std::printf("  linear scan:  %.4f s (%lld)\n", scan_stab, scan_found);
+    std::printf("  interval_set: %.4f s (%lld)\n", tree_stab, tree_found);
+}
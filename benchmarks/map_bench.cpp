@@ -0,0 +1,80 @@
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "../containers/map.hpp"
+#include "../containers/set.hpp"
+
+
+// the set-of-pairs workaround map replaces: the count is mutable so it can
+// change through set's iterator, and a miss costs a find and then an insert
+struct counted_key
+{
+    int key;
+    mutable long long count;
+
+    bool operator < ( const counted_key& other ) const { return key < other.key; }
+};
+
+template< class Aggregate >
+static double time_aggregate( const std::vector<int>& keys, Aggregate aggregate, long long& checksum )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    checksum = aggregate(keys);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+int main()
+{
+    // 4M updates to 100k and to 1M distinct keys, the aggregation loop shape
+    std::mt19937 rng(11);
+    for (int distinct : { 100000, 1000000 })
+    {
+        std::vector<int> keys(4000000);
+        for (int& key : keys) key = static_cast<int>(rng() % distinct);
+
+        std::printf("4M updates over %d keys\n", distinct);
+        long long checksum;
+
+        double std_map = time_aggregate(keys, []( const std::vector<int>& ks ) {
+            std::map<int, long long> m;
+            for (int key : ks) m[key] += key;
+            return static_cast<long long>(m.size()) + m.rbegin()->second;
+        }, checksum);
+        std::printf("  std::map operator[]:        %.4f s (%lld)\n", std_map, checksum);
+
+        double find_insert = time_aggregate(keys, []( const std::vector<int>& ks ) {
+            set<counted_key> s;
+            for (int key : ks)
+            {
+                auto it = s.find(counted_key{ key, 0 });
+                if (it == s.end()) it = s.insert(counted_key{ key, 0 }).first;
+                it->count += key;
+            }
+            return static_cast<long long>(s.size()) + std::prev(s.end())->count;
+        }, checksum);
+        std::printf("  set of pairs, find+insert:  %.4f s (%lld)\n", find_insert, checksum);
+
+        double own_map = time_aggregate(keys, []( const std::vector<int>& ks ) {
+            map<int, long long> m;
+            for (int key : ks) m[key] += key;
+            return static_cast<long long>(m.size()) + std::prev(m.end())->second;
+        }, checksum);
+        std::printf("  map operator[]:             %.4f s (%lld)\n", own_map, checksum);
+
+        double assign = time_aggregate(keys, []( const std::vector<int>& ks ) {
+            map<int, long long> m;
+            for (int key : ks) m.insert_or_assign(key, static_cast<long long>(key));
+            return static_cast<long long>(m.size()) + std::prev(m.end())->second;
+        }, checksum);
+        std::printf("  map insert_or_assign:       %.4f s (%lld)\n", assign, checksum);
+        std::printf(" \n");
+    }
+
+    return 0;
+}
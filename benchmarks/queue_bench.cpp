@@ -0,0 +1,117 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../containers/concurrent_queue.hpp"
+#include "../containers/list.hpp"
+
+
+// the baseline the lock-free queues replace
+class locked_list_queue
+{
+public:
+    bool try_push_back( long value )
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_items.push_back(value);
+        return true;
+    }
+
+    bool try_pop_front( long& out )
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_items.empty()) return false;
+
+        out = m_items.front();
+        m_items.pop_front();
+        return true;
+    }
+
+private:
+    std::mutex m_mutex;
+    list<long> m_items;
+};
+
+class unbounded_queue
+{
+public:
+    bool try_push_back( long value ) { m_queue.push_back(value); return true; }
+    bool try_pop_front( long& out ) { return m_queue.try_pop_front(out); }
+
+private:
+    mpmc_queue<long> m_queue;
+};
+
+class bounded_queue
+{
+public:
+    bool try_push_back( long value ) { return m_queue.try_push_back(value); }
+    bool try_pop_front( long& out ) { return m_queue.try_pop_front(out); }
+
+private:
+    bounded_mpmc_queue<long> m_queue{ 1 << 14 };
+};
+
+template< class Queue >
+static void run( const char* name, int producers, int consumers, long per_producer )
+{
+    Queue queue;
+    std::atomic<long> consumed{ 0 };
+    std::atomic<long> checksum{ 0 };
+    const long total = per_producer * producers;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+        threads.emplace_back([&queue, p, per_producer] {
+            for (long i = 0; i < per_producer; ++i)
+                while (!queue.try_push_back(p * per_producer + i)) std::this_thread::yield();
+        });
+
+    for (int c = 0; c < consumers; ++c)
+        threads.emplace_back([&queue, &consumed, &checksum, total] {
+            long value, sum = 0;
+            while (consumed.load(std::memory_order_relaxed) < total)
+            {
+                if (queue.try_pop_front(value))
+                {
+                    sum += value;
+                    consumed.fetch_add(1, std::memory_order_relaxed);
+                }
+                else std::this_thread::yield();
+            }
+            checksum.fetch_add(sum);
+        });
+
+    for (auto& t : threads) t.join();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> dur = stop - start;
+
+    bool valid = checksum.load() == total * (total - 1) / 2;
+    std::printf("%s %dP/%dC: %.2f Mops/s%s\n", name, producers, consumers,
+        total / dur.count() / 1e6, valid ? "" : " CHECKSUM MISMATCH");
+}
+
+int main()
+{
+    const long per_producer = 500000;
+
+    std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+    for (int producers : { 1, 2, 4, 8 })
+    {
+        for (int consumers : { 1, 2, 4, 8 })
+        {
+            run<locked_list_queue>("list+mutex", producers, consumers, per_producer);
+            run<unbounded_queue>("mpmc_queue", producers, consumers, per_producer);
+            run<bounded_queue>("bounded_mpmc_queue", producers, consumers, per_producer);
+        }
+        std::printf(" \n");
+    }
+
+    return 0;
+}
@@ -0,0 +1,95 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <malloc.h>
+#include <random>
+#include <vector>
+
+#include "../containers/roaring_set.hpp"
+#include "../containers/set.hpp"
+
+
+// bytes currently handed out by malloc, includes the per-allocation overhead
+// and the large blocks malloc serves with mmap
+static size_t heap_in_use()
+{
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+static double seconds_since( std::chrono::high_resolution_clock::time_point start )
+{
+    std::chrono::duration<double> dur = std::chrono::high_resolution_clock::now() - start;
+    return dur.count();
+}
+
+// the results.txt workload: 1M random inserts in [0, 1e6], then 1M lookups,
+// one ordered pass and set algebra against a second set of the same shape
+template< class Set >
+static void run( const char* name, const std::vector<std::uint32_t>& keys, const std::vector<std::uint32_t>& other, const std::vector<std::uint32_t>& probes )
+{
+    size_t before = heap_in_use();
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Set s;
+    for (std::uint32_t key : keys) s.insert(key);
+
+    double insert = seconds_since(start);
+    size_t bytes = heap_in_use() - before;
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t found = 0;
+    for (std::uint32_t key : probes) found += s.contains(key);
+    double find = seconds_since(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    long long sum = 0;
+    for (std::uint32_t key : s) sum += key;
+    double iterate = seconds_since(start);
+
+    Set t;
+    for (std::uint32_t key : other) t.insert(key);
+
+    start = std::chrono::high_resolution_clock::now();
+    size_t sizes = set_union(s, t).size() + set_intersection(s, t).size() + set_difference(s, t).size();
+    double algebra = seconds_since(start);
+
+    std::printf("%s: %zu keys, %.2f bytes per key, insert %.4f s, find %.4f s (%zu found), iteration %.4f s (sum %lld), union+intersection+difference %.4f s (%zu keys)\n",
+        name, s.size(), double(bytes) / s.size(), insert, find, found, iterate, sum, algebra, sizes);
+}
+
+int main()
+{
+    std::mt19937 rng(42);
+    std::vector<std::uint32_t> keys(1000000), other(1000000), probes(1000000);
+    for (std::uint32_t& key : keys) key = rng() % 1000001;
+    for (std::uint32_t& key : other) key = rng() % 1000001;
+    for (std::uint32_t& key : probes) key = rng() % 2000001;
+
+    // roaring_set first: its 8 KiB allocations after a million freed set nodes
+    // would time malloc consolidating them rather than the container
+    run<roaring_set<>>("roaring_set", keys, other, probes);
+    run<set<std::uint32_t>>("set", keys, other, probes);
+
+    // conversion both ways
+    set<std::uint32_t> tree(keys.begin(), keys.end());
+    auto start = std::chrono::high_resolution_clock::now();
+    roaring_set<> bitmap(tree);
+    double to_roaring = seconds_since(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    set<std::uint32_t> back = bitmap.to_set();
+    double to_tree = seconds_since(start);
+
+    std::printf("set -> roaring_set %.4f s (%zu bytes), roaring_set -> set %.4f s (%zu keys)\n",
+        to_roaring, bitmap.memory_usage(), to_tree, back.size());
+
+    // sorted dense ranges collapse into run containers
+    std::vector<std::uint32_t> ranges;
+    for (std::uint32_t lo = 0; lo < 10000000; lo += 100000)
+        for (std::uint32_t key = lo; key < lo + 50000; ++key) ranges.push_back(key);
+    roaring_set<> runs(ranges.begin(), ranges.end());
+    std::printf("100 ranges of 50000 keys: %zu keys in %zu bytes\n", runs.size(), runs.memory_usage());
+
+    return 0;
+}
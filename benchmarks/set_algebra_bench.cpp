@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "../containers/set.hpp"
+
+
+static set<int> random_set( size_t count, int range, unsigned seed )
+{
+    std::mt19937 rng(seed);
+    std::vector<int> keys(count);
+    for (int& key : keys) key = static_cast<int>(rng() % range);
+    return set<int>(keys.begin(), keys.end());
+}
+
+// operands are copied outside the timed region, the algorithms consume them
+template< class Op >
+static double time_op( const set<int>& a, const set<int>& b, Op op, size_t& result )
+{
+    set<int> left(a), right(b);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    set<int> out = op(std::move(left), std::move(right));
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    result = out.size();
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+static void run( const char* name, const set<int>& a, const set<int>& b )
+{
+    size_t result = 0;
+    std::printf("%s (|a| = %zu, |b| = %zu)\n", name, a.size(), b.size());
+
+    double naive = time_op(a, b, []( set<int> x, set<int> y ) {
+        for (int key : y) x.insert(key);
+        return x;
+    }, result);
+    std::printf("  union by insert:        %.4f s, %zu keys\n", naive, result);
+
+    for (unsigned threads : { 1u, 2u, 4u, 8u })
+    {
+        double u = time_op(a, b, [threads]( set<int> x, set<int> y ) { return set_union(std::move(x), std::move(y), threads); }, result);
+        std::printf("  set_union        %u thr: %.4f s, %zu keys\n", threads, u, result);
+        double i = time_op(a, b, [threads]( set<int> x, set<int> y ) { return set_intersection(std::move(x), std::move(y), threads); }, result);
+        std::printf("  set_intersection %u thr: %.4f s, %zu keys\n", threads, i, result);
+        double d = time_op(a, b, [threads]( set<int> x, set<int> y ) { return set_difference(std::move(x), std::move(y), threads); }, result);
+        std::printf("  set_difference   %u thr: %.4f s, %zu keys\n", threads, d, result);
+    }
+    std::printf(" \n");
+}
+
+// 100 sorted batches of 4096 keys spread over the key range into a copy of
+// base, one insert per key against insert_sorted_batch
+template< class Insert >
+static double time_batches( const set<int>& base, const std::vector<std::vector<int>>& batches, Insert insert, size_t& result )
+{
+    set<int> s(base);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const std::vector<int>& batch : batches) insert(s, batch);
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    result = s.size();
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+static void run_batches( const set<int>& base )
+{
+    std::mt19937 rng(4);
+    std::vector<std::vector<int>> batches(100, std::vector<int>(4096));
+    for (std::vector<int>& batch : batches)
+    {
+        for (int& key : batch) key = static_cast<int>(rng() % 4000000);
+        std::sort(batch.begin(), batch.end());
+    }
+
+    size_t result = 0;
+    std::printf("sorted batches of 4096 into %zu keys\n", base.size());
+
+    double single = time_batches(base, batches, []( set<int>& s, const std::vector<int>& batch ) {
+        for (int key : batch) s.insert(key);
+    }, result);
+    std::printf("  insert per key:            %.4f s, %zu keys\n", single, result);
+
+    double hinted = time_batches(base, batches, []( set<int>& s, const std::vector<int>& batch ) {
+        auto hint = s.end();
+        for (int key : batch) hint = std::next(s.emplace_hint(hint, key));
+    }, result);
+    std::printf("  emplace_hint per key:      %.4f s, %zu keys\n", hinted, result);
+
+    for (unsigned threads : { 1u, 4u })
+    {
+        double bulk = time_batches(base, batches, [threads]( set<int>& s, const std::vector<int>& batch ) {
+            s.insert_sorted_batch(batch.begin(), batch.end(), threads);
+        }, result);
+        std::printf("  insert_sorted_batch %u thr: %.4f s, %zu keys\n", threads, bulk, result);
+    }
+    std::printf(" \n");
+}
+
+int main()
+{
+    std::printf("hardware threads: %u\n", std::thread::hardware_concurrency());
+
+    set<int> big_a = random_set(2000000, 4000000, 1);
+    set<int> big_b = random_set(2000000, 4000000, 2);
+    set<int> small = random_set(1000, 4000000, 3);
+
+    run("equal sizes", big_a, big_b);
+    run("large with small", big_a, small);
+    run_batches(big_a);
+
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include <chrono>
+#include <experimental/random>
+#include <iostream>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+#include "../containers/btree_set.hpp"
+#include "../containers/persistent_set.hpp"
+#include "../containers/set.hpp"
+#include "../containers/unordered_flat_set.hpp"
+#include "../memory/pool_allocator.hpp"
+
+
+// 1M random inserts in [0, 1e6], the workload recorded in results.txt
+template< class Set >
+static double insertion_time()
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Set s;
+    for (int i = 0; i < 1000000; i++)
+    {
+        int random_number = std::experimental::randint(0, 1000000);
+        s.insert(random_number);
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+// building from 1M sorted keys, the range constructor against one insert per key
+template< class Set >
+static double construction_time( const std::vector<int>& keys, bool bulk )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (bulk)
+    {
+        Set s(keys.begin(), keys.end());
+    }
+    else
+    {
+        Set s;
+        for (int key : keys) s.insert(key);
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+// 1M lookups of random keys, about half of them present
+template< class Set >
+static double find_time( const Set& s, const std::vector<int>& probes, size_t& found )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    found = 0;
+    for (int key : probes) found += s.find(key) != s.end();
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+// one pass over every key, in order for the ordered sets
+template< class Set >
+static double iteration_time( const Set& s, long long& sum )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    sum = 0;
+    for (auto it = s.begin(); it != s.end(); ++it) sum += *it;
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+template< class Set >
+static void lookup_times( const char* name, const std::vector<int>& keys, const std::vector<int>& probes )
+{
+    Set s;
+    for (int key : keys) s.insert(key);
+
+    size_t found;
+    long long sum;
+    double find = find_time(s, probes, found);
+    double iterate = iteration_time(s, sum);
+    std::cout << name << ": find " << find << " (" << found << " hits), iteration " << iterate << " (sum " << sum << ")\n";
+}
+
+// 100k windows [lo, lo + 200) over 1M keys, stepping iterators against one range scan
+static void window_times( const std::vector<int>& keys )
+{
+    set<int> s;
+    for (int key : keys) s.insert(key);
+
+    std::vector<int> starts(100000);
+    for (int& lo : starts) lo = std::experimental::randint(0, 2000000);
+
+    long long stepped = 0, scanned = 0;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int lo : starts)
+        for (auto it = s.lower_bound(lo), last = s.lower_bound(lo + 200); it != last; ++it) stepped += *it;
+    auto middle = std::chrono::high_resolution_clock::now();
+    for (int lo : starts)
+        s.for_each_in_range(lo, lo + 200, [&scanned]( int key ) { scanned += key; });
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> step_dur = middle - start;
+    std::chrono::duration<double> scan_dur = stop - middle;
+    std::cout << "own_set iterators: " << step_dur.count() << " (sum " << stepped << ")\n";
+    std::cout << "own_set for_each_in_range: " << scan_dur.count() << " (sum " << scanned << ")\n";
+}
+
+// one stream of keys inserted with or without hinting end(), as an ingest loop would
+template< class Set >
+static double stream_time( const std::vector<int>& keys, bool hinted )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    Set s;
+    if (hinted) for (int key : keys) s.insert(s.end(), key);
+    else for (int key : keys) s.insert(key);
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+static void stream_times( const char* name, const std::vector<int>& keys )
+{
+    std::cout << name << ": std_set " << stream_time<std::set<int>>(keys, false)
+              << ", std_set hinted " << stream_time<std::set<int>>(keys, true)
+              << ", own_set " << stream_time<set<int>>(keys, false)
+              << ", own_set hinted " << stream_time<set<int>>(keys, true) << "\n";
+}
+
+// the random stream into persistent_set, snapshotting every `every` inserts as
+// a checkpointer would; each snapshot forces the next updates to copy their path
+static double snapshot_time( const std::vector<int>& keys, int every )
+{
+    auto start = std::chrono::high_resolution_clock::now();
+
+    persistent_set<int> s;
+    persistent_set<int> checkpoint;
+    for (size_t i = 0; i < keys.size(); i++)
+    {
+        if (every > 0 && i % every == 0) checkpoint = s.snapshot();
+        s.insert(keys[i]);
+    }
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+// moving every key of one set into another, as shard rebalancing does:
+// 0 copies and erases, 1 extracts node handles, 2 merges
+static double move_time( const std::vector<int>& keys, int how )
+{
+    set<int> from(keys.begin(), keys.end());
+    set<int> to;
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (how == 0)
+        for (auto it = from.begin(); it != from.end(); ) { to.insert(*it); it = from.erase(it); }
+    else if (how == 1)
+        while (!from.empty()) to.insert(from.extract(from.begin()));
+    else to.merge(from);
+
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+// clear() on a set of the random stream, the teardown of a per-batch index
+template< class Set >
+static double teardown_time( const std::vector<int>& keys )
+{
+    Set s(keys.begin(), keys.end());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    s.clear();
+    auto stop = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> dur = stop - start;
+    return dur.count();
+}
+
+// 2000 inserts under a small maximum load, which the table must keep to as it grows
+static bool small_load_holds( float max_load )
+{
+    unordered_flat_set<int> s;
+    s.max_load_factor(max_load);
+    for (int i = 0; i < 2000; i++) s.insert(i);
+
+    std::cout << "max load " << max_load << ": " << s.bucket_count() << " buckets, load " << s.load_factor() << "\n";
+    return s.size() == 2000 && s.load_factor() <= max_load;
+}
+
+int main()
+{
+    std::cout << "std::set versus own_set versus btree_set, hashed sets alongside\n";
+    std::cout << "insertion time \n";
+
+    for (int i = 0; i < 10; i++)
+    {
+        std::cout << "std_set: " << insertion_time<std::set<int>>() << "\n";
+        std::cout << "own_set: " << insertion_time<set<int>>() << "\n";
+        std::cout << "own_set_pool: " << insertion_time<set<int, std::less<int>, pool_allocator<int>>>() << "\n";
+        std::cout << "btree_set: " << insertion_time<btree_set<int>>() << "\n";
+        std::cout << "std_unordered_set: " << insertion_time<std::unordered_set<int>>() << "\n";
+        std::cout << "unordered_flat_set: " << insertion_time<unordered_flat_set<int>>() << "\n";
+        std::cout << " \n";
+    }
+
+    std::vector<int> sorted(1000000);
+    for (int i = 0; i < 1000000; i++) sorted[i] = i;
+
+    std::cout << "construction from sorted keys \n";
+    std::cout << "std_set range: " << construction_time<std::set<int>>(sorted, true) << "\n";
+    std::cout << "own_set range: " << construction_time<set<int>>(sorted, true) << "\n";
+    std::cout << "own_set inserts: " << construction_time<set<int>>(sorted, false) << "\n";
+    std::cout << "btree_set inserts: " << construction_time<btree_set<int>>(sorted, false) << "\n";
+
+    std::vector<int> keys(1000000), probes(1000000);
+    for (int& key : keys) key = std::experimental::randint(0, 2000000);
+    for (int& key : probes) key = std::experimental::randint(0, 2000000);
+
+    std::cout << "lookup on 1M random keys \n";
+    lookup_times<std::set<int>>("std_set", keys, probes);
+    lookup_times<set<int>>("own_set", keys, probes);
+    lookup_times<btree_set<int>>("btree_set", keys, probes);
+    lookup_times<std::unordered_set<int>>("std_unordered_set", keys, probes);
+    lookup_times<unordered_flat_set<int>>("unordered_flat_set", keys, probes);
+
+    std::cout << "range windows \n";
+    window_times(keys);
+
+    // 1% of the sorted keys swapped with a neighbour up to 16 places on
+    std::vector<int> nearly_sorted = sorted;
+    for (int i = 0; i < 10000; i++)
+    {
+        int at = std::experimental::randint(0, 999983);
+        std::swap(nearly_sorted[at], nearly_sorted[at + std::experimental::randint(1, 16)]);
+    }
+
+    std::cout << "insert streams \n";
+    stream_times("sorted", sorted);
+    stream_times("nearly sorted", nearly_sorted);
+    stream_times("random", keys);
+
+    std::cout << "moving keys between sets: copy and erase " << move_time(keys, 0)
+              << ", extract and insert " << move_time(keys, 1)
+              << ", merge " << move_time(keys, 2) << "\n";
+
+    std::cout << "teardown: std_set " << teardown_time<std::set<int>>(keys)
+              << ", own_set " << teardown_time<set<int>>(keys)
+              << ", own_set_pool " << teardown_time<set<int, std::less<int>, pool_allocator<int>>>(keys) << "\n";
+
+    std::cout << "persistent_set inserts: no snapshots " << snapshot_time(keys, 0)
+              << ", snapshot every 1000 " << snapshot_time(keys, 1000)
+              << ", snapshot every 10 " << snapshot_time(keys, 10) << "\n";
+
+    std::cout << "unordered_flat_set under small maximum loads \n";
+    bool held = true;
+    for (float max_load : { 0.5f, 0.05f, 0.01f, 0.001f }) held &= small_load_holds(max_load);
+
+    return held ? 0 : 1;
+}
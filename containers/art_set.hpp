@@ -0,0 +1,1146 @@
+#ifndef _ART_SET_HPP_
+#define _ART_SET_HPP_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// The bytes art_set branches on for a key, compared unsigned byte by byte in
+// the order of the keys.
+template< class Key >
+struct art_key_traits;
+
+// strings of single-byte characters as they are, which is std::char_traits order
+template< class CharT, class Allocator > requires (sizeof(CharT) == 1)
+struct art_key_traits<std::basic_string<CharT, std::char_traits<CharT>, Allocator>>
+{
+    static constexpr bool prefix_keys = true;
+
+    static std::span<const unsigned char> encode( const std::basic_string<CharT, std::char_traits<CharT>, Allocator>& key ) noexcept
+    {
+        return { reinterpret_cast<const unsigned char*>(key.data()), key.size() };
+    }
+};
+
+// integers big-endian, with the sign bit flipped so negative keys come first
+template< std::integral T > requires (!std::same_as<T, bool>)
+struct art_key_traits<T>
+{
+    static constexpr bool prefix_keys = false;
+
+    static std::array<unsigned char, sizeof(T)> encode( T key ) noexcept
+    {
+        using U = std::make_unsigned_t<T>;
+        U bits = static_cast<U>(key);
+        if constexpr (std::is_signed_v<T>) bits ^= U(1) << (sizeof(T) * 8 - 1);
+
+        std::array<unsigned char, sizeof(T)> bytes;
+        for (size_t i = 0; i < sizeof(T); ++i) bytes[i] = static_cast<unsigned char>(bits >> (8 * (sizeof(T) - 1 - i)));
+        return bytes;
+    }
+};
+
+
+// Adaptive radix tree: a set branching on one key byte per level, with inner
+// nodes sized to their fan-out (4, 16, 48 or 256 children) and chains of
+// single-child nodes folded into a compressed path kept in the node below. A
+// lookup reads each key byte once and compares whole keys only at the leaf it
+// reaches, instead of at every level as set does, which pays off for keys with
+// long shared prefixes. Node16 is searched with one SSE2 compare where available.
+//
+// Keys are strings of single-byte characters, in std::string order, or
+// integers, in numeric order; art_key_traits gives their bytes. Leaves hold the
+// keys and are linked in key order, so iteration and prefix_range walk a list.
+// Compressed paths longer than max_prefix bytes are stored only in part and the
+// rest is checked at the leaf. Inserts and erases invalidate only iterators to
+// the erased keys.
+template< class Key, class Allocator = std::allocator<Key> >
+class art_set
+{
+private:
+    using traits = art_key_traits<Key>;
+    using key_bytes = decltype(traits::encode(std::declval<const Key&>()));
+
+    class leaf_iter;
+    struct link;
+    struct leaf;
+    struct inner;
+
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using allocator_type = Allocator;
+    using reference = const Key&;
+    using const_reference = const Key&;
+    using iterator = leaf_iter;
+    using const_iterator = leaf_iter;
+    using reverse_iterator = std::reverse_iterator<leaf_iter>;
+    using const_reverse_iterator = std::reverse_iterator<leaf_iter>;
+
+    // path bytes stored in an inner node, longer paths are checked at the leaf
+    static constexpr size_t max_prefix = 8;
+
+public:
+    // constructors
+    art_set() = default;
+    explicit art_set( const Allocator& alloc ) : m_alloc(alloc) {}
+    template< std::input_iterator InputIt >
+    art_set( InputIt first, InputIt last, const Allocator& alloc = Allocator() ) : m_alloc(alloc) { insert(first, last); }
+    art_set( std::initializer_list<Key> init, const Allocator& alloc = Allocator() ) : art_set(init.begin(), init.end(), alloc) {}
+    art_set( const art_set& other )
+        : m_alloc(std::allocator_traits<Allocator>::select_on_container_copy_construction(other.m_alloc)) { insert(other.begin(), other.end()); }
+    art_set( art_set&& other ) noexcept : m_alloc(other.m_alloc) { swap(other); }
+    ~art_set() { clear(); }
+
+    art_set& operator = ( const art_set& other );
+    art_set& operator = ( art_set&& other ) noexcept;
+
+    allocator_type get_allocator() const noexcept { return m_alloc; }
+
+    // iterators
+    iterator begin() const noexcept { return iterator(m_head.next); }
+    iterator cbegin() const noexcept { return begin(); }
+    iterator end() const noexcept { return iterator(&m_head); }
+    iterator cend() const noexcept { return end(); }
+    reverse_iterator rbegin() const noexcept { return reverse_iterator(end()); }
+    reverse_iterator rend() const noexcept { return reverse_iterator(begin()); }
+
+    // capacity
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    size_type size() const noexcept { return m_size; }
+
+    // modifiers
+    void clear() noexcept;
+    std::pair<iterator, bool> insert( const Key& key ) { return insert_key(key); }
+    std::pair<iterator, bool> insert( Key&& key ) { return insert_key(std::move(key)); }
+    template< std::input_iterator InputIt >
+    void insert( InputIt first, InputIt last ) { for (; first != last; ++first) insert_key(*first); }
+    size_type erase( const Key& key );
+    iterator erase( const_iterator pos );
+    void swap( art_set& other ) noexcept;
+
+    // lookup
+    iterator find( const Key& key ) const;
+    bool contains( const Key& key ) const { return find_leaf(key) != nullptr; }
+    size_type count( const Key& key ) const { return contains(key) ? 1 : 0; }
+
+    // the keys starting with prefix, a subtree of the radix tree and so a
+    // contiguous run of the leaf list
+    std::pair<iterator, iterator> prefix_range( const Key& prefix ) const requires traits::prefix_keys;
+    template< class Fn >
+    void for_each_prefix( const Key& prefix, Fn fn ) const requires traits::prefix_keys
+    {
+        auto [first, last] = prefix_range(prefix);
+        for (; first != last; ++first) fn(*first);
+    }
+
+    bool operator == ( const art_set& other ) const { return m_size == other.m_size && std::equal(begin(), end(), other.begin()); }
+    bool operator != ( const art_set& other ) const { return !(*this == other); }
+
+private:
+    // a child slot: 0 for none, a leaf pointer with the low bit set, or an inner node
+    using child = std::uintptr_t;
+
+    enum class node_type : std::uint8_t { node4, node16, node48, node256 };
+
+    // the leaves form a list in key order, closed through m_head
+    struct link
+    {
+        link* prev;
+        link* next;
+    };
+
+    struct leaf : link
+    {
+        Key key;
+
+        template< class... Args >
+        explicit leaf( Args&&... args ) : link{ nullptr, nullptr }, key(std::forward<Args>(args)...) {}
+    };
+
+    // shared by the four node sizes: the compressed path below the parent's
+    // branch byte, and the leaf of the key that ends right after that path
+    struct inner
+    {
+        std::uint32_t prefix_len = 0;
+        std::uint16_t count = 0;
+        node_type type;
+        unsigned char prefix[max_prefix] = {};
+        leaf* terminal = nullptr;
+
+        explicit inner( node_type t ) : type(t) {}
+    };
+
+    // Node4 and Node16: branch bytes kept sorted, children in the same order
+    template< unsigned N >
+    struct sorted_node : inner
+    {
+        unsigned char keys[N] = {};
+        child children[N] = {};
+
+        sorted_node() : inner(N == 4 ? node_type::node4 : node_type::node16) {}
+    };
+    using node4 = sorted_node<4>;
+    using node16 = sorted_node<16>;
+
+    // a byte per branch byte, 0 for none or 1 + the slot of the child
+    struct node48 : inner
+    {
+        unsigned char index[256] = {};
+        child children[48] = {};
+
+        node48() : inner(node_type::node48) {}
+    };
+
+    struct node256 : inner
+    {
+        child children[256] = {};
+
+        node256() : inner(node_type::node256) {}
+    };
+
+    class leaf_iter
+    {
+    private:
+        friend class art_set;
+
+    public:
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using reference = const Key&;
+        using pointer = const Key*;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+    private:
+        explicit leaf_iter( const link* node ) : m_link(node) {}
+
+        const link* m_link = nullptr;
+
+    public:
+        leaf_iter() = default;
+
+        reference operator * () const noexcept { return static_cast<const leaf*>(m_link)->key; }
+        pointer operator -> () const noexcept { return &static_cast<const leaf*>(m_link)->key; }
+
+        leaf_iter& operator ++ () noexcept { m_link = m_link->next; return *this; }
+        leaf_iter operator ++ (int) noexcept { leaf_iter tmp = *this; ++(*this); return tmp; }
+        leaf_iter& operator -- () noexcept { m_link = m_link->prev; return *this; }
+        leaf_iter operator -- (int) noexcept { leaf_iter tmp = *this; --(*this); return tmp; }
+
+        bool operator == ( const leaf_iter& other ) const noexcept { return m_link == other.m_link; }
+        bool operator != ( const leaf_iter& other ) const noexcept { return !(*this == other); }
+    };
+
+    static bool is_leaf( child c ) noexcept { return (c & 1) != 0; }
+    static leaf* as_leaf( child c ) noexcept { return reinterpret_cast<leaf*>(c & ~child(1)); }
+    static inner* as_inner( child c ) noexcept { return reinterpret_cast<inner*>(c); }
+    static child to_child( leaf* node ) noexcept { return reinterpret_cast<child>(node) | 1; }
+    static child to_child( inner* node ) noexcept { return reinterpret_cast<child>(node); }
+
+    template< class T, class... Args >
+    T* create( Args&&... args );
+    template< class T >
+    void destroy( T* node ) noexcept;
+    void free_inner( inner* node ) noexcept;
+    void destroy_tree( child c ) noexcept;
+
+    // per-node operations; next_child and prev_child take -1 and 256 for the
+    // first and the last child, and return 0 when there is none
+    static child* find_child( inner* node, unsigned char byte ) noexcept;
+    static child next_child( const inner* node, int after ) noexcept;
+    static child prev_child( const inner* node, int before ) noexcept;
+    template< class Fn >
+    static void for_each_child( const inner* node, Fn fn );
+    template< unsigned N >
+    static unsigned sorted_rank( const sorted_node<N>* node, unsigned char byte ) noexcept;
+    template< unsigned N >
+    static void append_child( sorted_node<N>* node, unsigned char byte, child c ) noexcept { node->keys[node->count] = byte; node->children[node->count++] = c; }
+    static void append_child( node48* node, unsigned char byte, child c ) noexcept { node->children[node->count] = c; node->index[byte] = static_cast<unsigned char>(++node->count); }
+    static void append_child( node256* node, unsigned char byte, child c ) noexcept { node->children[byte] = c; ++node->count; }
+    static void set_prefix( inner* node, const unsigned char* path, size_t length ) noexcept;
+
+    // growing replaces the node in ref with the next size up; removing a child
+    // shrinks it, or folds a node left with one entry into its parent's slot
+    void add_child( child& ref, inner* node, unsigned char byte, child c );
+    void remove_child( child& ref, inner* node, unsigned char byte );
+    void shrink( child& ref, inner* node );
+    template< class To >
+    To* convert( child& ref, inner* node );
+    void collapse( child& ref, node4* node ) noexcept;
+
+    static leaf* min_leaf( child c ) noexcept;
+    static leaf* max_leaf( child c ) noexcept;
+
+    // the stored path bytes only, see find_leaf
+    static bool prefix_may_match( const inner* node, const key_bytes& bytes, size_t depth ) noexcept;
+    // how many path bytes match key from depth, reading a leaf past the stored ones
+    static size_t prefix_match( const inner* node, child c, const key_bytes& bytes, size_t depth ) noexcept;
+
+    leaf* find_leaf( const Key& key ) const;
+    template< class K >
+    std::pair<iterator, bool> insert_key( K&& key );
+    template< class K >
+    leaf* split_leaf( child& ref, size_t depth, const key_bytes& bytes, K&& key );
+    template< class K >
+    leaf* split_path( child& ref, size_t depth, size_t match, const key_bytes& bytes, K&& key );
+    template< class K >
+    leaf* add_leaf( child& ref, inner* node, unsigned char byte, K&& key );
+
+    void link_before( leaf* node, link* pos ) noexcept;
+    void unlink( leaf* node ) noexcept;
+
+    child m_root = 0;
+    link m_head{ &m_head, &m_head };
+    size_t m_size = 0;
+    [[no_unique_address]] Allocator m_alloc;
+};
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>& art_set<Key, Allocator>::operator = ( const art_set& other )
+{
+    if (this != &other)
+    {
+        art_set copy(other);
+        swap(copy);
+    }
+    return *this;
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>& art_set<Key, Allocator>::operator = ( art_set&& other ) noexcept
+{
+    if (this != &other)
+    {
+        clear();
+        swap(other);
+    }
+    return *this;
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::clear() noexcept
+{
+    destroy_tree(m_root);
+    m_root = 0;
+    m_head.prev = m_head.next = &m_head;
+    m_size = 0;
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::swap( art_set& other ) noexcept
+{
+    std::swap(m_root, other.m_root);
+    std::swap(m_head, other.m_head);
+    std::swap(m_size, other.m_size);
+    std::swap(m_alloc, other.m_alloc);
+
+    // the end leaves still point at the other head
+    for (art_set* s : { this, &other })
+    {
+        if (s->m_size == 0) s->m_head.prev = s->m_head.next = &s->m_head;
+        else s->m_head.next->prev = s->m_head.prev->next = &s->m_head;
+    }
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::size_type art_set<Key, Allocator>::erase( const Key& key )
+{
+    // key may be the erased leaf's own, so bytes are not read once it is gone
+    key_bytes bytes = traits::encode(key);
+    if (m_root == 0) return 0;
+
+    if (is_leaf(m_root))
+    {
+        leaf* only = as_leaf(m_root);
+        if (!(only->key == key)) return 0;
+        m_root = 0;
+        unlink(only);
+        return 1;
+    }
+
+    child* ref = &m_root;
+    size_t depth = 0;
+    while (true)
+    {
+        inner* node = as_inner(*ref);
+        if (node->prefix_len != 0)
+        {
+            if (!prefix_may_match(node, bytes, depth)) return 0;
+            depth += node->prefix_len;
+        }
+
+        if (depth == bytes.size())
+        {
+            leaf* found = node->terminal;
+            if (found == nullptr || !(found->key == key)) return 0;
+            node->terminal = nullptr;
+            shrink(*ref, node);
+            unlink(found);
+            return 1;
+        }
+
+        unsigned char byte = bytes[depth];
+        child* slot = find_child(node, byte);
+        if (slot == nullptr) return 0;
+        if (is_leaf(*slot))
+        {
+            leaf* found = as_leaf(*slot);
+            if (!(found->key == key)) return 0;
+            remove_child(*ref, node, byte);
+            unlink(found);
+            return 1;
+        }
+
+        ref = slot;
+        ++depth;
+    }
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::iterator art_set<Key, Allocator>::erase( const_iterator pos )
+{
+    iterator next(pos.m_link->next);
+    erase(*pos);
+    return next;
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::iterator art_set<Key, Allocator>::find( const Key& key ) const
+{
+    leaf* found = find_leaf(key);
+    return found != nullptr ? iterator(found) : end();
+}
+
+template< class Key, class Allocator >
+inline std::pair<typename art_set<Key, Allocator>::iterator, typename art_set<Key, Allocator>::iterator>
+art_set<Key, Allocator>::prefix_range( const Key& prefix ) const requires traits::prefix_keys
+{
+    key_bytes bytes = traits::encode(prefix);
+
+    // descend to the smallest subtree whose shared path covers the prefix; the
+    // path bytes skipped on the way are checked on one of its leaves
+    child c = m_root;
+    size_t depth = 0;
+    while (c != 0 && !is_leaf(c))
+    {
+        inner* node = as_inner(c);
+        size_t stored = std::min<size_t>({ node->prefix_len, max_prefix, bytes.size() - depth });
+        if (std::memcmp(node->prefix, bytes.data() + depth, stored) != 0) return std::make_pair(end(), end());
+        if (bytes.size() - depth <= node->prefix_len) break;
+
+        depth += node->prefix_len;
+        child* slot = find_child(node, bytes[depth]);
+        c = slot != nullptr ? *slot : 0;
+        ++depth;
+    }
+    if (c == 0) return std::make_pair(end(), end());
+
+    key_bytes first = traits::encode(min_leaf(c)->key);
+    if (first.size() < bytes.size() || std::memcmp(first.data(), bytes.data(), bytes.size()) != 0) return std::make_pair(end(), end());
+    return std::make_pair(iterator(min_leaf(c)), iterator(max_leaf(c)->next));
+}
+
+template< class Key, class Allocator >
+template< class T, class... Args >
+inline T* art_set<Key, Allocator>::create( Args&&... args )
+{
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+    using node_allocator_traits = std::allocator_traits<node_allocator>;
+
+    node_allocator alloc(m_alloc);
+    T* node = node_allocator_traits::allocate(alloc, 1);
+    try
+    {
+        node_allocator_traits::construct(alloc, node, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        node_allocator_traits::deallocate(alloc, node, 1);
+        throw;
+    }
+    return node;
+}
+
+template< class Key, class Allocator >
+template< class T >
+inline void art_set<Key, Allocator>::destroy( T* node ) noexcept
+{
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<T>;
+    using node_allocator_traits = std::allocator_traits<node_allocator>;
+
+    node_allocator alloc(m_alloc);
+    node_allocator_traits::destroy(alloc, node);
+    node_allocator_traits::deallocate(alloc, node, 1);
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::free_inner( inner* node ) noexcept
+{
+    switch (node->type)
+    {
+    case node_type::node4: destroy(static_cast<node4*>(node)); break;
+    case node_type::node16: destroy(static_cast<node16*>(node)); break;
+    case node_type::node48: destroy(static_cast<node48*>(node)); break;
+    case node_type::node256: destroy(static_cast<node256*>(node)); break;
+    }
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::destroy_tree( child c ) noexcept
+{
+    if (c == 0) return;
+    if (is_leaf(c))
+    {
+        destroy(as_leaf(c));
+        return;
+    }
+
+    inner* node = as_inner(c);
+    if (node->terminal != nullptr) destroy(node->terminal);
+    for_each_child(node, [this]( unsigned char, child below ) { destroy_tree(below); });
+    free_inner(node);
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::child* art_set<Key, Allocator>::find_child( inner* node, unsigned char byte ) noexcept
+{
+    switch (node->type)
+    {
+    case node_type::node4:
+    {
+        node4* n = static_cast<node4*>(node);
+        for (unsigned i = 0; i < n->count; ++i)
+            if (n->keys[i] == byte) return &n->children[i];
+        return nullptr;
+    }
+    case node_type::node16:
+    {
+        node16* n = static_cast<node16*>(node);
+#if defined(__SSE2__)
+        // all 16 branch bytes at once, the ones past count masked off
+        __m128i hits = _mm_cmpeq_epi8(_mm_set1_epi8(static_cast<char>(byte)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(n->keys)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hits)) & ((1u << n->count) - 1);
+        return mask != 0 ? &n->children[std::countr_zero(mask)] : nullptr;
+#else
+        for (unsigned i = 0; i < n->count; ++i)
+            if (n->keys[i] == byte) return &n->children[i];
+        return nullptr;
+#endif
+    }
+    case node_type::node48:
+    {
+        node48* n = static_cast<node48*>(node);
+        unsigned slot = n->index[byte];
+        return slot != 0 ? &n->children[slot - 1] : nullptr;
+    }
+    case node_type::node256:
+    {
+        node256* n = static_cast<node256*>(node);
+        return n->children[byte] != 0 ? &n->children[byte] : nullptr;
+    }
+    }
+    return nullptr;
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::child art_set<Key, Allocator>::next_child( const inner* node, int after ) noexcept
+{
+    switch (node->type)
+    {
+    case node_type::node4:
+    case node_type::node16:
+    {
+        const unsigned char* keys = node->type == node_type::node4 ? static_cast<const node4*>(node)->keys : static_cast<const node16*>(node)->keys;
+        const child* children = node->type == node_type::node4 ? static_cast<const node4*>(node)->children : static_cast<const node16*>(node)->children;
+        for (unsigned i = 0; i < node->count; ++i)
+            if (keys[i] > after) return children[i];
+        return 0;
+    }
+    case node_type::node48:
+    {
+        const node48* n = static_cast<const node48*>(node);
+        for (int byte = after + 1; byte < 256; ++byte)
+            if (n->index[byte] != 0) return n->children[n->index[byte] - 1];
+        return 0;
+    }
+    case node_type::node256:
+    {
+        const node256* n = static_cast<const node256*>(node);
+        for (int byte = after + 1; byte < 256; ++byte)
+            if (n->children[byte] != 0) return n->children[byte];
+        return 0;
+    }
+    }
+    return 0;
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::child art_set<Key, Allocator>::prev_child( const inner* node, int before ) noexcept
+{
+    switch (node->type)
+    {
+    case node_type::node4:
+    case node_type::node16:
+    {
+        const unsigned char* keys = node->type == node_type::node4 ? static_cast<const node4*>(node)->keys : static_cast<const node16*>(node)->keys;
+        const child* children = node->type == node_type::node4 ? static_cast<const node4*>(node)->children : static_cast<const node16*>(node)->children;
+        for (unsigned i = node->count; i-- > 0;)
+            if (keys[i] < before) return children[i];
+        return 0;
+    }
+    case node_type::node48:
+    {
+        const node48* n = static_cast<const node48*>(node);
+        for (int byte = before - 1; byte >= 0; --byte)
+            if (n->index[byte] != 0) return n->children[n->index[byte] - 1];
+        return 0;
+    }
+    case node_type::node256:
+    {
+        const node256* n = static_cast<const node256*>(node);
+        for (int byte = before - 1; byte >= 0; --byte)
+            if (n->children[byte] != 0) return n->children[byte];
+        return 0;
+    }
+    }
+    return 0;
+}
+
+template< class Key, class Allocator >
+template< class Fn >
+inline void art_set<Key, Allocator>::for_each_child( const inner* node, Fn fn )
+{
+    // in branch byte order
+    switch (node->type)
+    {
+    case node_type::node4:
+    {
+        const node4* n = static_cast<const node4*>(node);
+        for (unsigned i = 0; i < n->count; ++i) fn(n->keys[i], n->children[i]);
+        break;
+    }
+    case node_type::node16:
+    {
+        const node16* n = static_cast<const node16*>(node);
+        for (unsigned i = 0; i < n->count; ++i) fn(n->keys[i], n->children[i]);
+        break;
+    }
+    case node_type::node48:
+    {
+        const node48* n = static_cast<const node48*>(node);
+        for (unsigned byte = 0; byte < 256; ++byte)
+            if (n->index[byte] != 0) fn(static_cast<unsigned char>(byte), n->children[n->index[byte] - 1]);
+        break;
+    }
+    case node_type::node256:
+    {
+        const node256* n = static_cast<const node256*>(node);
+        for (unsigned byte = 0; byte < 256; ++byte)
+            if (n->children[byte] != 0) fn(static_cast<unsigned char>(byte), n->children[byte]);
+        break;
+    }
+    }
+}
+
+template< class Key, class Allocator >
+template< unsigned N >
+inline unsigned art_set<Key, Allocator>::sorted_rank( const sorted_node<N>* node, unsigned char byte ) noexcept
+{
+    // the number of branch bytes below byte
+#if defined(__SSE2__)
+    if constexpr (N == 16)
+    {
+        // SSE2 compares signed bytes, flipping the top bit orders them unsigned
+        const __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+        __m128i keys = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(node->keys)), flip);
+        __m128i less = _mm_cmplt_epi8(keys, _mm_xor_si128(_mm_set1_epi8(static_cast<char>(byte)), flip));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(less)) & ((1u << node->count) - 1);
+        return static_cast<unsigned>(std::popcount(mask));
+    }
+#endif
+    unsigned rank = 0;
+    while (rank < node->count && node->keys[rank] < byte) ++rank;
+    return rank;
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::set_prefix( inner* node, const unsigned char* path, size_t length ) noexcept
+{
+    node->prefix_len = static_cast<std::uint32_t>(length);
+    std::memmove(node->prefix, path, std::min(length, max_prefix));
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::add_child( child& ref, inner* node, unsigned char byte, child c )
+{
+    switch (node->type)
+    {
+    case node_type::node4:
+        if (node->count == 4)
+        {
+            add_child(ref, convert<node16>(ref, node), byte, c);
+            return;
+        }
+        break;
+    case node_type::node16:
+        if (node->count == 16)
+        {
+            add_child(ref, convert<node48>(ref, node), byte, c);
+            return;
+        }
+        break;
+    case node_type::node48:
+        if (node->count == 48)
+        {
+            add_child(ref, convert<node256>(ref, node), byte, c);
+            return;
+        }
+        break;
+    case node_type::node256:
+        break;
+    }
+
+    auto insert_sorted = [byte, c]( auto* n ) {
+        unsigned pos = sorted_rank(n, byte);
+        std::memmove(n->keys + pos + 1, n->keys + pos, n->count - pos);
+        std::memmove(n->children + pos + 1, n->children + pos, (n->count - pos) * sizeof(child));
+        n->keys[pos] = byte;
+        n->children[pos] = c;
+        ++n->count;
+    };
+
+    switch (node->type)
+    {
+    case node_type::node4: insert_sorted(static_cast<node4*>(node)); break;
+    case node_type::node16: insert_sorted(static_cast<node16*>(node)); break;
+    case node_type::node48:
+    {
+        // erases leave holes, take the first free slot
+        node48* n = static_cast<node48*>(node);
+        unsigned slot = 0;
+        while (n->children[slot] != 0) ++slot;
+        n->children[slot] = c;
+        n->index[byte] = static_cast<unsigned char>(slot + 1);
+        ++n->count;
+        break;
+    }
+    case node_type::node256: append_child(static_cast<node256*>(node), byte, c); break;
+    }
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::remove_child( child& ref, inner* node, unsigned char byte )
+{
+    auto remove_sorted = [byte]( auto* n ) {
+        unsigned pos = 0;
+        while (n->keys[pos] != byte) ++pos;
+        std::memmove(n->keys + pos, n->keys + pos + 1, n->count - pos - 1);
+        std::memmove(n->children + pos, n->children + pos + 1, (n->count - pos - 1) * sizeof(child));
+        --n->count;
+    };
+
+    switch (node->type)
+    {
+    case node_type::node4: remove_sorted(static_cast<node4*>(node)); break;
+    case node_type::node16: remove_sorted(static_cast<node16*>(node)); break;
+    case node_type::node48:
+    {
+        node48* n = static_cast<node48*>(node);
+        n->children[n->index[byte] - 1] = 0;
+        n->index[byte] = 0;
+        --n->count;
+        break;
+    }
+    case node_type::node256:
+    {
+        node256* n = static_cast<node256*>(node);
+        n->children[byte] = 0;
+        --n->count;
+        break;
+    }
+    }
+
+    shrink(ref, node);
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::shrink( child& ref, inner* node )
+{
+    // below the size the next smaller node grows at, so that alternating
+    // inserts and erases do not convert back and forth
+    try
+    {
+        switch (node->type)
+        {
+        case node_type::node4:
+            if (node->count + (node->terminal != nullptr ? 1 : 0) <= 1) collapse(ref, static_cast<node4*>(node));
+            break;
+        case node_type::node16:
+            if (node->count <= 3) convert<node4>(ref, node);
+            break;
+        case node_type::node48:
+            if (node->count <= 12) convert<node16>(ref, node);
+            break;
+        case node_type::node256:
+            if (node->count <= 37) convert<node48>(ref, node);
+            break;
+        }
+    }
+    catch (...)
+    {
+        // out of memory for the smaller node, the larger one stays valid
+    }
+}
+
+template< class Key, class Allocator >
+template< class To >
+inline To* art_set<Key, Allocator>::convert( child& ref, inner* node )
+{
+    To* resized = create<To>();
+    set_prefix(resized, node->prefix, node->prefix_len);
+    resized->terminal = node->terminal;
+    for_each_child(node, [resized]( unsigned char byte, child c ) { append_child(resized, byte, c); });
+
+    ref = to_child(resized);
+    free_inner(node);
+    return resized;
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::collapse( child& ref, node4* node ) noexcept
+{
+    if (node->count == 0) ref = to_child(node->terminal);
+    else
+    {
+        child only = node->children[0];
+        if (!is_leaf(only))
+        {
+            // the child's path grows by this node's path and the branch byte
+            inner* below = as_inner(only);
+            unsigned char path[max_prefix];
+            size_t length = std::min<size_t>(node->prefix_len, max_prefix);
+            std::memcpy(path, node->prefix, length);
+            if (length < max_prefix) path[length++] = node->keys[0];
+            for (size_t i = 0; length < max_prefix && i < std::min<size_t>(below->prefix_len, max_prefix); ++i) path[length++] = below->prefix[i];
+
+            std::memcpy(below->prefix, path, length);
+            below->prefix_len += node->prefix_len + 1;
+        }
+        ref = only;
+    }
+    destroy(node);
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::leaf* art_set<Key, Allocator>::min_leaf( child c ) noexcept
+{
+    // a terminal comes before every key below its node
+    while (!is_leaf(c))
+    {
+        inner* node = as_inner(c);
+        if (node->terminal != nullptr) return node->terminal;
+        c = next_child(node, -1);
+    }
+    return as_leaf(c);
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::leaf* art_set<Key, Allocator>::max_leaf( child c ) noexcept
+{
+    while (!is_leaf(c))
+    {
+        inner* node = as_inner(c);
+        child last = prev_child(node, 256);
+        if (last == 0) return node->terminal;
+        c = last;
+    }
+    return as_leaf(c);
+}
+
+template< class Key, class Allocator >
+inline bool art_set<Key, Allocator>::prefix_may_match( const inner* node, const key_bytes& bytes, size_t depth ) noexcept
+{
+    if (bytes.size() - depth < node->prefix_len) return false;
+    return std::memcmp(node->prefix, bytes.data() + depth, std::min<size_t>(node->prefix_len, max_prefix)) == 0;
+}
+
+template< class Key, class Allocator >
+inline size_t art_set<Key, Allocator>::prefix_match( const inner* node, child c, const key_bytes& bytes, size_t depth ) noexcept
+{
+    size_t limit = std::min<size_t>(node->prefix_len, bytes.size() - depth);
+    size_t stored = std::min(limit, max_prefix);
+
+    size_t match = 0;
+    while (match < stored && node->prefix[match] == bytes[depth + match]) ++match;
+    if (match < stored || match == limit) return match;
+
+    // every leaf below carries the whole path
+    key_bytes path = traits::encode(min_leaf(c)->key);
+    while (match < limit && path[depth + match] == bytes[depth + match]) ++match;
+    return match;
+}
+
+template< class Key, class Allocator >
+inline art_set<Key, Allocator>::leaf* art_set<Key, Allocator>::find_leaf( const Key& key ) const
+{
+    key_bytes bytes = traits::encode(key);
+
+    // only the stored path bytes are compared on the way down, the key at the
+    // leaf settles the rest
+    child c = m_root;
+    size_t depth = 0;
+    while (c != 0)
+    {
+        if (is_leaf(c))
+        {
+            leaf* found = as_leaf(c);
+            return found->key == key ? found : nullptr;
+        }
+
+        inner* node = as_inner(c);
+        if (node->prefix_len != 0)
+        {
+            if (!prefix_may_match(node, bytes, depth)) return nullptr;
+            depth += node->prefix_len;
+        }
+
+        if (depth == bytes.size())
+        {
+            leaf* found = node->terminal;
+            return found != nullptr && found->key == key ? found : nullptr;
+        }
+
+        child* slot = find_child(node, bytes[depth]);
+        if (slot == nullptr) return nullptr;
+        c = *slot;
+        ++depth;
+    }
+    return nullptr;
+}
+
+template< class Key, class Allocator >
+template< class K >
+inline std::pair<typename art_set<Key, Allocator>::iterator, bool> art_set<Key, Allocator>::insert_key( K&& key )
+{
+    // bytes may view key, they are read before key is moved into its leaf
+    key_bytes bytes = traits::encode(key);
+
+    if (m_root == 0)
+    {
+        leaf* added = create<leaf>(std::forward<K>(key));
+        m_root = to_child(added);
+        link_before(added, &m_head);
+        return std::make_pair(iterator(added), true);
+    }
+
+    child* ref = &m_root;
+    size_t depth = 0;
+    while (true)
+    {
+        if (is_leaf(*ref))
+        {
+            leaf* existing = as_leaf(*ref);
+            if (existing->key == key) return std::make_pair(iterator(existing), false);
+            return std::make_pair(iterator(split_leaf(*ref, depth, bytes, std::forward<K>(key))), true);
+        }
+
+        inner* node = as_inner(*ref);
+        if (node->prefix_len != 0)
+        {
+            size_t match = prefix_match(node, *ref, bytes, depth);
+            if (match < node->prefix_len) return std::make_pair(iterator(split_path(*ref, depth, match, bytes, std::forward<K>(key))), true);
+            depth += node->prefix_len;
+        }
+
+        if (depth == bytes.size())
+        {
+            // the path is exact here, so a terminal is this key
+            if (node->terminal != nullptr) return std::make_pair(iterator(node->terminal), false);
+
+            leaf* next = min_leaf(next_child(node, -1));
+            leaf* added = create<leaf>(std::forward<K>(key));
+            node->terminal = added;
+            link_before(added, next);
+            return std::make_pair(iterator(added), true);
+        }
+
+        unsigned char byte = bytes[depth];
+        child* slot = find_child(node, byte);
+        if (slot == nullptr) return std::make_pair(iterator(add_leaf(*ref, node, byte, std::forward<K>(key))), true);
+
+        ref = slot;
+        ++depth;
+    }
+}
+
+template< class Key, class Allocator >
+template< class K >
+inline art_set<Key, Allocator>::leaf* art_set<Key, Allocator>::split_leaf( child& ref, size_t depth, const key_bytes& bytes, K&& key )
+{
+    // a node4 over both keys at their first difference; a key ending there is its terminal
+    leaf* existing = as_leaf(ref);
+    key_bytes old_bytes = traits::encode(existing->key);
+
+    size_t split = depth;
+    size_t limit = std::min<size_t>(old_bytes.size(), bytes.size());
+    while (split < limit && old_bytes[split] == bytes[split]) ++split;
+
+    bool new_ends = split == bytes.size();
+    bool old_ends = split == old_bytes.size();
+    unsigned char new_byte = new_ends ? 0 : bytes[split];
+    unsigned char old_byte = old_ends ? 0 : old_bytes[split];
+    bool before = new_ends || (!old_ends && new_byte < old_byte);
+
+    node4* node = create<node4>();
+    set_prefix(node, bytes.data() + depth, split - depth);
+
+    leaf* added;
+    try
+    {
+        added = create<leaf>(std::forward<K>(key));
+    }
+    catch (...)
+    {
+        destroy(node);
+        throw;
+    }
+
+    if (new_ends) node->terminal = added;
+    if (old_ends) node->terminal = existing;
+    if (before)
+    {
+        if (!new_ends) append_child(node, new_byte, to_child(added));
+        if (!old_ends) append_child(node, old_byte, to_child(existing));
+    }
+    else
+    {
+        if (!old_ends) append_child(node, old_byte, to_child(existing));
+        if (!new_ends) append_child(node, new_byte, to_child(added));
+    }
+
+    ref = to_child(node);
+    link_before(added, before ? existing : existing->next);
+    return added;
+}
+
+template< class Key, class Allocator >
+template< class K >
+inline art_set<Key, Allocator>::leaf* art_set<Key, Allocator>::split_path( child& ref, size_t depth, size_t match, const key_bytes& bytes, K&& key )
+{
+    // a node4 at the first path byte the key does not share, over the old node
+    // with the rest of its path and the new key
+    inner* node = as_inner(ref);
+    const unsigned char* path = node->prefix;
+    key_bytes leaf_bytes{};
+    if (node->prefix_len > max_prefix)
+    {
+        leaf_bytes = traits::encode(min_leaf(ref)->key);
+        path = leaf_bytes.data() + depth;
+    }
+
+    bool new_ends = depth + match == bytes.size();
+    unsigned char new_byte = new_ends ? 0 : bytes[depth + match];
+    unsigned char old_byte = path[match];
+    bool before = new_ends || new_byte < old_byte;
+    link* pos = before ? static_cast<link*>(min_leaf(ref)) : max_leaf(ref)->next;
+
+    node4* parent = create<node4>();
+    set_prefix(parent, path, match);
+
+    leaf* added;
+    try
+    {
+        added = create<leaf>(std::forward<K>(key));
+    }
+    catch (...)
+    {
+        destroy(parent);
+        throw;
+    }
+
+    set_prefix(node, path + match + 1, node->prefix_len - match - 1);
+    if (new_ends)
+    {
+        parent->terminal = added;
+        append_child(parent, old_byte, to_child(node));
+    }
+    else if (before)
+    {
+        append_child(parent, new_byte, to_child(added));
+        append_child(parent, old_byte, to_child(node));
+    }
+    else
+    {
+        append_child(parent, old_byte, to_child(node));
+        append_child(parent, new_byte, to_child(added));
+    }
+
+    ref = to_child(parent);
+    link_before(added, pos);
+    return added;
+}
+
+template< class Key, class Allocator >
+template< class K >
+inline art_set<Key, Allocator>::leaf* art_set<Key, Allocator>::add_leaf( child& ref, inner* node, unsigned char byte, K&& key )
+{
+    // the new key goes before the first key of the next branch, or after the
+    // last key of the previous one or the terminal
+    link* pos;
+    if (child after = next_child(node, byte); after != 0) pos = min_leaf(after);
+    else if (child before = prev_child(node, byte); before != 0) pos = max_leaf(before)->next;
+    else pos = node->terminal->next;
+
+    leaf* added = create<leaf>(std::forward<K>(key));
+    try
+    {
+        add_child(ref, node, byte, to_child(added));
+    }
+    catch (...)
+    {
+        destroy(added);
+        throw;
+    }
+
+    link_before(added, pos);
+    return added;
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::link_before( leaf* node, link* pos ) noexcept
+{
+    node->next = pos;
+    node->prev = pos->prev;
+    pos->prev->next = node;
+    pos->prev = node;
+    ++m_size;
+}
+
+template< class Key, class Allocator >
+inline void art_set<Key, Allocator>::unlink( leaf* node ) noexcept
+{
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    destroy(node);
+    --m_size;
+}
+
+#endif // !_ART_SET_HPP_
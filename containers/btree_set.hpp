@@ -0,0 +1,799 @@
+#ifndef _BTREE_SET_HPP_
+#define _BTREE_SET_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <utility>
+
+
+// Ordered set with the interface of set, stored as a B-tree.
+// Each node holds up to max_keys keys side by side in NodeBytes of cache-line
+// aligned memory, so a lookup touches one or two lines per level instead of one
+// per comparison. Searching inside a node is a branchless binary search.
+// Keys move between nodes on insert and erase: unlike set, any insert or erase
+// invalidates all iterators.
+template<
+    class Key,
+    class Compare = std::less<Key>,
+    class Allocator = std::allocator<Key>,
+    size_t NodeBytes = 256
+> class btree_set
+{
+private:
+    class btree_iter;
+    struct base_node;
+    struct inner_node;
+
+    static_assert(NodeBytes % 64 == 0, "btree_set: NodeBytes must be a multiple of the cache line");
+
+    static constexpr size_t header_bytes = sizeof(void*) + 2 * sizeof(std::uint16_t) + sizeof(bool);
+    static constexpr size_t key_offset = (header_bytes + alignof(Key) - 1) / alignof(Key) * alignof(Key);
+
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using reference = Key&;
+    using const_reference = const Key&;
+    using pointer = std::allocator_traits<Allocator>::pointer;
+    using const_pointer = std::allocator_traits<Allocator>::const_pointer;
+    using iterator = btree_iter;
+    using const_iterator = btree_iter;
+
+    static constexpr size_t max_keys = NodeBytes >= key_offset + 3 * sizeof(Key) ? (NodeBytes - key_offset) / sizeof(Key) : 3;
+    static constexpr size_t min_keys = max_keys / 2;
+
+    static_assert(max_keys < UINT16_MAX, "btree_set: too many keys per node");
+
+public:
+    // constructors and destructor
+    btree_set() = default;
+    explicit btree_set( const Compare& comp, const Allocator& alloc = Allocator() )
+        : m_comp(comp), m_leaf_alloc(alloc), m_inner_alloc(alloc) {}
+    explicit btree_set( const Allocator& alloc ) : m_leaf_alloc(alloc), m_inner_alloc(alloc) {}
+    template< std::input_iterator InputIt >
+    btree_set( InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator() );
+    template< std::input_iterator InputIt >
+    btree_set( InputIt first, InputIt last, const Allocator& alloc ) : btree_set(first, last, Compare(), alloc) {}
+    btree_set( const btree_set& other );
+    btree_set( const btree_set& other, const Allocator& alloc );
+    btree_set( btree_set&& other ) noexcept;
+    btree_set( std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator() )
+        : btree_set(init.begin(), init.end(), comp, alloc) {}
+    btree_set( std::initializer_list<value_type> init, const Allocator& alloc ) : btree_set(init, Compare(), alloc) {}
+    ~btree_set() { clear(); }
+
+    // assignment operators
+    btree_set& operator=( const btree_set& other );
+    btree_set& operator=( btree_set&& other );
+    btree_set& operator=( std::initializer_list<value_type> ilist );
+
+    allocator_type get_allocator() const noexcept { return m_leaf_alloc; }
+
+    // iterators
+    iterator begin() const noexcept { return iterator(m_leftmost, 0); }
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    iterator end() const noexcept { return iterator(m_rightmost, m_rightmost ? m_rightmost->count : 0); }
+    const_iterator cend() const noexcept { return end(); }
+
+    // capacity
+    bool empty() const noexcept { return m_size == 0ull; }
+    size_type size() const noexcept { return m_size; }
+
+    // modifiers
+    void clear();
+
+    std::pair<iterator, bool> insert( const value_type& key ) { return insert_unique(key); }
+    std::pair<iterator, bool> insert( value_type&& key ) { return insert_unique(std::move(key)); }
+
+    iterator erase( const_iterator pos );
+    size_type erase( const key_type& key );
+
+    // lookup
+    iterator find( const key_type& key ) const;
+    bool contains( const key_type& key ) const { return find(key) != end(); }
+    size_type count( const key_type& key ) const { return contains(key) ? 1 : 0; }
+    iterator lower_bound( const key_type& key ) const;
+
+    // observers
+    key_compare key_comp() const { return m_comp; }
+    value_compare value_comp() const { return m_comp; }
+
+
+private:
+    // a leaf, and the leading part of every inner node
+    struct alignas(64) base_node
+    {
+        inner_node* parent = nullptr;
+        std::uint16_t position = 0;     // index among the parent's children
+        std::uint16_t count = 0;
+        bool leaf;
+        alignas(Key) unsigned char storage[max_keys * sizeof(Key)];
+
+        explicit base_node( bool is_leaf = true ) : leaf(is_leaf) {}
+
+        Key* keys() noexcept { return std::launder(reinterpret_cast<Key*>(storage)); }
+        const Key* keys() const noexcept { return std::launder(reinterpret_cast<const Key*>(storage)); }
+    };
+
+    struct inner_node : base_node
+    {
+        base_node* children[max_keys + 1] = {};
+
+        inner_node() : base_node(false) {}
+    };
+
+    class btree_iter
+    {
+    private:
+        friend class btree_set;
+
+        btree_iter( const base_node* node, size_type pos ) : m_node(const_cast<base_node*>(node)), m_pos(pos) {}
+
+        base_node* m_node;
+        size_type m_pos;
+
+    public:
+        using iterator_type = btree_set::value_type;
+        using value_type = iterator_type;
+        using difference_type = ptrdiff_t;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        btree_iter() : m_node(nullptr), m_pos(0) {}
+
+        reference operator * () const noexcept { return m_node->keys()[m_pos]; }
+        pointer operator -> () const noexcept { return m_node->keys() + m_pos; }
+        btree_iter& operator ++ () { increment(); return *this; }
+        btree_iter& operator -- () { decrement(); return *this; }
+        btree_iter operator ++ (int) { btree_iter tmp = *this; ++(*this); return tmp; }
+        btree_iter operator -- (int) { btree_iter tmp = *this; --(*this); return tmp; }
+        bool operator == ( const btree_iter& other ) const { return m_node == other.m_node && m_pos == other.m_pos; }
+        bool operator != ( const btree_iter& other ) const { return !(*this == other); }
+
+    private:
+        void increment();
+        void decrement();
+    };
+
+    using leaf_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<base_node>;
+    using leaf_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<base_node>;
+    using inner_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<inner_node>;
+    using inner_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<inner_node>;
+
+    base_node* m_root = nullptr;
+    base_node* m_leftmost = nullptr;
+    base_node* m_rightmost = nullptr;
+    size_type m_size = 0ull;
+    [[no_unique_address]] Compare m_comp;
+    leaf_allocator m_leaf_alloc;
+    inner_allocator m_inner_alloc;
+
+    static base_node* child( const base_node* node, size_type i ) { return static_cast<const inner_node*>(node)->children[i]; }
+    static inner_node* as_inner( base_node* node ) { return static_cast<inner_node*>(node); }
+
+    // first key in the node not less than key, branchless so the compiler emits cmov
+    size_type search( const base_node* node, const Key& key ) const
+    {
+        const Key* first = node->keys();
+        const Key* base = first;
+        size_type len = node->count;
+        if (len == 0) return 0;
+
+        while (len > 1)
+        {
+            size_type half = len / 2;
+            base = m_comp(base[half], key) ? base + half : base;
+            len -= half;
+        }
+        return static_cast<size_type>(base - first) + m_comp(*base, key);
+    }
+
+    base_node* create_leaf();
+    inner_node* create_inner();
+    void destroy_node( base_node* node );
+    void destroy_subtree( base_node* node );
+    base_node* clone_subtree( const base_node* node, inner_node* parent, size_type position );
+    void adopt( const btree_set& other );
+    void take_tree( btree_set& other );
+
+    template< class K >
+    static void place_key( base_node* node, size_type pos, K&& key );
+    static void remove_key( base_node* node, size_type pos );
+
+    template< class K >
+    std::pair<iterator, bool> insert_unique( K&& key );
+    base_node* split_node( base_node* node, bool append );
+
+    void rebalance( base_node* node, base_node*& track, size_type& track_pos );
+    void borrow_from_left( inner_node* parent, size_type i, base_node*& track, size_type& track_pos );
+    void borrow_from_right( inner_node* parent, size_type i );
+    void merge_children( inner_node* parent, size_type i, base_node*& track, size_type& track_pos );
+};
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::btree_iter::increment()
+{
+    if (!m_node->leaf)
+    {
+        base_node* node = child(m_node, m_pos + 1);
+        while (!node->leaf) node = child(node, 0);
+        m_node = node;
+        m_pos = 0;
+        return;
+    }
+
+    if (++m_pos < m_node->count) return;
+
+    // climb to the first ancestor with a key to the right, past the root stays at end
+    base_node* node = m_node;
+    size_type pos = m_pos;
+    while (pos == node->count && node->parent != nullptr)
+    {
+        pos = node->position;
+        node = node->parent;
+    }
+    if (pos < node->count)
+    {
+        m_node = node;
+        m_pos = pos;
+    }
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::btree_iter::decrement()
+{
+    if (!m_node->leaf)
+    {
+        base_node* node = child(m_node, m_pos);
+        while (!node->leaf) node = child(node, node->count);
+        m_node = node;
+        m_pos = node->count - 1;
+        return;
+    }
+
+    if (m_pos > 0)
+    {
+        --m_pos;
+        return;
+    }
+
+    base_node* node = m_node;
+    while (node->position == 0 && node->parent != nullptr) node = node->parent;
+    m_pos = node->position - 1;
+    m_node = node->parent;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+template< std::input_iterator InputIt >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::btree_set( InputIt first, InputIt last, const Compare& comp, const Allocator& alloc )
+    : m_comp(comp), m_leaf_alloc(alloc), m_inner_alloc(alloc)
+{
+    try
+    {
+        for (; first != last; ++first) insert(*first);
+    }
+    catch (...)
+    {
+        clear();
+        throw;
+    }
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::btree_set( const btree_set& other )
+    : m_comp(other.m_comp),
+      m_leaf_alloc(leaf_allocator_traits::select_on_container_copy_construction(other.m_leaf_alloc)),
+      m_inner_alloc(inner_allocator_traits::select_on_container_copy_construction(other.m_inner_alloc))
+{
+    adopt(other);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::btree_set( const btree_set& other, const Allocator& alloc )
+    : m_comp(other.m_comp), m_leaf_alloc(alloc), m_inner_alloc(alloc)
+{
+    adopt(other);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::btree_set( btree_set&& other ) noexcept
+    : m_comp(other.m_comp), m_leaf_alloc(other.m_leaf_alloc), m_inner_alloc(other.m_inner_alloc)
+{
+    take_tree(other);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>& btree_set<Key, Compare, Allocator, NodeBytes>::operator=( const btree_set& other )
+{
+    if (this == &other) return *this;
+
+    clear();
+    if constexpr (leaf_allocator_traits::propagate_on_container_copy_assignment::value)
+    {
+        m_leaf_alloc = other.m_leaf_alloc;
+        m_inner_alloc = other.m_inner_alloc;
+    }
+    m_comp = other.m_comp;
+
+    adopt(other);
+    return *this;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>& btree_set<Key, Compare, Allocator, NodeBytes>::operator=( btree_set&& other )
+{
+    if (this == &other) return *this;
+
+    clear();
+    if constexpr (leaf_allocator_traits::propagate_on_container_move_assignment::value)
+    {
+        m_leaf_alloc = other.m_leaf_alloc;
+        m_inner_alloc = other.m_inner_alloc;
+    }
+    m_comp = other.m_comp;
+
+    if (m_leaf_alloc == other.m_leaf_alloc) take_tree(other);
+    else
+    {
+        for (const auto& key : other) insert(key);
+        other.clear();
+    }
+    return *this;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>& btree_set<Key, Compare, Allocator, NodeBytes>::operator=( std::initializer_list<value_type> ilist )
+{
+    clear();
+    for (const auto& key : ilist) insert(key);
+    return *this;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::base_node* btree_set<Key, Compare, Allocator, NodeBytes>::create_leaf()
+{
+    base_node* node = leaf_allocator_traits::allocate(m_leaf_alloc, 1);
+    leaf_allocator_traits::construct(m_leaf_alloc, node);
+    return node;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::inner_node* btree_set<Key, Compare, Allocator, NodeBytes>::create_inner()
+{
+    inner_node* node = inner_allocator_traits::allocate(m_inner_alloc, 1);
+    inner_allocator_traits::construct(m_inner_alloc, node);
+    return node;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::destroy_node( base_node* node )
+{
+    // keys must already be destroyed
+    if (node->leaf)
+    {
+        leaf_allocator_traits::destroy(m_leaf_alloc, node);
+        leaf_allocator_traits::deallocate(m_leaf_alloc, node, 1);
+    }
+    else
+    {
+        inner_node* inner = as_inner(node);
+        inner_allocator_traits::destroy(m_inner_alloc, inner);
+        inner_allocator_traits::deallocate(m_inner_alloc, inner, 1);
+    }
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::destroy_subtree( base_node* node )
+{
+    if (node == nullptr) return;
+
+    if (!node->leaf)
+        for (size_type i = 0; i <= node->count; ++i) destroy_subtree(child(node, i));
+
+    std::destroy_n(node->keys(), node->count);
+    destroy_node(node);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::base_node* btree_set<Key, Compare, Allocator, NodeBytes>::clone_subtree( const base_node* node, inner_node* parent, size_type position )
+{
+    base_node* copy = node->leaf ? create_leaf() : create_inner();
+    copy->parent = parent;
+    copy->position = static_cast<std::uint16_t>(position);
+
+    try
+    {
+        for (; copy->count < node->count; ++copy->count)
+            std::construct_at(copy->keys() + copy->count, node->keys()[copy->count]);
+
+        // children not cloned yet stay null for destroy_subtree
+        if (!node->leaf)
+            for (size_type i = 0; i <= node->count; ++i)
+                as_inner(copy)->children[i] = clone_subtree(child(node, i), as_inner(copy), i);
+    }
+    catch (...)
+    {
+        destroy_subtree(copy);
+        throw;
+    }
+
+    return copy;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::adopt( const btree_set& other )
+{
+    if (other.m_root == nullptr) return;
+
+    m_root = clone_subtree(other.m_root, nullptr, 0);
+    m_size = other.m_size;
+
+    m_leftmost = m_rightmost = m_root;
+    while (!m_leftmost->leaf) m_leftmost = child(m_leftmost, 0);
+    while (!m_rightmost->leaf) m_rightmost = child(m_rightmost, m_rightmost->count);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::take_tree( btree_set& other )
+{
+    m_root = std::exchange(other.m_root, nullptr);
+    m_leftmost = std::exchange(other.m_leftmost, nullptr);
+    m_rightmost = std::exchange(other.m_rightmost, nullptr);
+    m_size = std::exchange(other.m_size, 0);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::clear()
+{
+    destroy_subtree(m_root);
+    m_root = m_leftmost = m_rightmost = nullptr;
+    m_size = 0;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+template< class K >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::place_key( base_node* node, size_type pos, K&& key )
+{
+    Key* keys = node->keys();
+    size_type count = node->count;
+
+    if (pos == count) std::construct_at(keys + count, std::forward<K>(key));
+    else
+    {
+        std::construct_at(keys + count, std::move(keys[count - 1]));
+        std::move_backward(keys + pos, keys + count - 1, keys + count);
+        keys[pos] = std::forward<K>(key);
+    }
+    ++node->count;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::remove_key( base_node* node, size_type pos )
+{
+    Key* keys = node->keys();
+    std::move(keys + pos + 1, keys + node->count, keys + pos);
+    std::destroy_at(keys + node->count - 1);
+    --node->count;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::iterator btree_set<Key, Compare, Allocator, NodeBytes>::lower_bound( const key_type& key ) const
+{
+    // the last separator passed on the left is the answer if the leaf has none
+    const base_node* node = m_root;
+    iterator candidate = end();
+    while (node != nullptr)
+    {
+        size_type pos = search(node, key);
+        if (pos < node->count)
+        {
+            candidate = iterator(node, pos);
+            if (!m_comp(key, node->keys()[pos])) break;
+        }
+        node = node->leaf ? nullptr : child(node, pos);
+    }
+    return candidate;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::iterator btree_set<Key, Compare, Allocator, NodeBytes>::find( const key_type& key ) const
+{
+    iterator it = lower_bound(key);
+    if (it == end() || m_comp(key, *it)) return end();
+    return it;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+template< class K >
+inline std::pair<typename btree_set<Key, Compare, Allocator, NodeBytes>::iterator, bool> btree_set<Key, Compare, Allocator, NodeBytes>::insert_unique( K&& key )
+{
+    if (m_root == nullptr) m_root = m_leftmost = m_rightmost = create_leaf();
+
+    base_node* node = m_root;
+    size_type pos;
+    while (true)
+    {
+        pos = search(node, key);
+        if (pos < node->count && !m_comp(key, node->keys()[pos])) return std::make_pair(iterator(node, pos), false);
+        if (node->leaf) break;
+        node = child(node, pos);
+    }
+
+    if (node->count == max_keys)
+    {
+        // appending past the largest key keeps the old leaf full, so sorted input packs nodes
+        bool append = node == m_rightmost && pos == node->count;
+        base_node* sibling = split_node(node, append);
+        if (pos > node->count)
+        {
+            pos -= node->count + 1;
+            node = sibling;
+        }
+    }
+
+    place_key(node, pos, std::forward<K>(key));
+    ++m_size;
+    return std::make_pair(iterator(node, pos), true);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::base_node* btree_set<Key, Compare, Allocator, NodeBytes>::split_node( base_node* node, bool append )
+{
+    if (node == m_root)
+    {
+        inner_node* root = create_inner();
+        root->children[0] = node;
+        node->parent = root;
+        node->position = 0;
+        m_root = root;
+    }
+    else if (node->parent->count == max_keys) split_node(node->parent, false);
+
+    inner_node* parent = node->parent;
+    size_type at = node->position;
+    base_node* sibling = node->leaf ? create_leaf() : create_inner();
+
+    // keys after mid move to the sibling, keys[mid] moves up as the separator
+    size_type mid = append ? node->count - 1 : node->count / 2;
+    size_type moved = node->count - mid - 1;
+    Key* keys = node->keys();
+
+    for (size_type i = 0; i < moved; ++i)
+    {
+        std::construct_at(sibling->keys() + i, std::move(keys[mid + 1 + i]));
+        std::destroy_at(keys + mid + 1 + i);
+    }
+    sibling->count = static_cast<std::uint16_t>(moved);
+
+    if (!node->leaf)
+    {
+        for (size_type i = 0; i <= moved; ++i)
+        {
+            base_node* moved_child = child(node, mid + 1 + i);
+            as_inner(sibling)->children[i] = moved_child;
+            moved_child->parent = as_inner(sibling);
+            moved_child->position = static_cast<std::uint16_t>(i);
+        }
+    }
+
+    for (size_type i = parent->count + 1; i > at + 1; --i)
+    {
+        parent->children[i] = parent->children[i - 1];
+        parent->children[i]->position = static_cast<std::uint16_t>(i);
+    }
+    parent->children[at + 1] = sibling;
+    sibling->parent = parent;
+    sibling->position = static_cast<std::uint16_t>(at + 1);
+
+    place_key(parent, at, std::move(keys[mid]));
+    std::destroy_at(keys + mid);
+    node->count = static_cast<std::uint16_t>(mid);
+
+    if (node == m_rightmost) m_rightmost = sibling;
+    return sibling;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::size_type btree_set<Key, Compare, Allocator, NodeBytes>::erase( const key_type& key )
+{
+    iterator it = find(key);
+    if (it == end()) return 0;
+
+    erase(it);
+    return 1;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline btree_set<Key, Compare, Allocator, NodeBytes>::iterator btree_set<Key, Compare, Allocator, NodeBytes>::erase( const_iterator pos )
+{
+    base_node* node = pos.m_node;
+    size_type i = pos.m_pos;
+
+    // an inner key is replaced by its predecessor, which always sits last in a leaf
+    bool inner = !node->leaf;
+    if (inner)
+    {
+        base_node* leaf = child(node, i);
+        while (!leaf->leaf) leaf = child(leaf, leaf->count);
+
+        node->keys()[i] = std::move(leaf->keys()[leaf->count - 1]);
+        node = leaf;
+        i = leaf->count - 1;
+    }
+
+    remove_key(node, i);
+    --m_size;
+
+    // track the slot after the removed key through the rebalancing
+    base_node* track = node;
+    size_type track_pos = i;
+    rebalance(node, track, track_pos);
+
+    if (track == nullptr) return end();
+
+    while (track_pos == track->count && track->parent != nullptr)
+    {
+        track_pos = track->position;
+        track = track->parent;
+    }
+    if (track_pos == track->count) return end();
+
+    // for an inner key the tracked slot holds the predecessor that replaced it
+    iterator result(track, track_pos);
+    if (inner) ++result;
+    return result;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::rebalance( base_node* node, base_node*& track, size_type& track_pos )
+{
+    while (node != m_root)
+    {
+        if (node->count >= min_keys) return;
+
+        inner_node* parent = node->parent;
+        size_type i = node->position;
+
+        if (i > 0 && child(parent, i - 1)->count > min_keys)
+        {
+            borrow_from_left(parent, i, track, track_pos);
+            return;
+        }
+        if (i < parent->count && child(parent, i + 1)->count > min_keys)
+        {
+            borrow_from_right(parent, i);
+            return;
+        }
+
+        if (i > 0) merge_children(parent, i - 1, track, track_pos);
+        else merge_children(parent, i, track, track_pos);
+
+        node = parent;
+    }
+
+    // the root may shrink to nothing, or to its only child
+    if (m_root->count > 0) return;
+
+    if (m_root->leaf)
+    {
+        destroy_node(m_root);
+        m_root = m_leftmost = m_rightmost = nullptr;
+        track = nullptr;
+    }
+    else
+    {
+        base_node* old_root = m_root;
+        m_root = child(old_root, 0);
+        m_root->parent = nullptr;
+        m_root->position = 0;
+        destroy_node(old_root);
+    }
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::borrow_from_left( inner_node* parent, size_type i, base_node*& track, size_type& track_pos )
+{
+    base_node* node = parent->children[i];
+    base_node* left = parent->children[i - 1];
+
+    if (!node->leaf)
+    {
+        inner_node* inner = as_inner(node);
+        for (size_type j = node->count + 1; j > 0; --j)
+        {
+            inner->children[j] = inner->children[j - 1];
+            inner->children[j]->position = static_cast<std::uint16_t>(j);
+        }
+        inner->children[0] = child(left, left->count);
+        inner->children[0]->parent = inner;
+        inner->children[0]->position = 0;
+    }
+
+    place_key(node, 0, std::move(parent->keys()[i - 1]));
+    parent->keys()[i - 1] = std::move(left->keys()[left->count - 1]);
+    remove_key(left, left->count - 1);
+
+    if (track == node) ++track_pos;
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::borrow_from_right( inner_node* parent, size_type i )
+{
+    base_node* node = parent->children[i];
+    base_node* right = parent->children[i + 1];
+
+    if (!node->leaf)
+    {
+        inner_node* inner = as_inner(node);
+        inner_node* right_inner = as_inner(right);
+        inner->children[node->count + 1] = right_inner->children[0];
+        inner->children[node->count + 1]->parent = inner;
+        inner->children[node->count + 1]->position = static_cast<std::uint16_t>(node->count + 1);
+
+        for (size_type j = 0; j < right->count; ++j)
+        {
+            right_inner->children[j] = right_inner->children[j + 1];
+            right_inner->children[j]->position = static_cast<std::uint16_t>(j);
+        }
+    }
+
+    place_key(node, node->count, std::move(parent->keys()[i]));
+    parent->keys()[i] = std::move(right->keys()[0]);
+    remove_key(right, 0);
+}
+
+template< class Key, class Compare, class Allocator, size_t NodeBytes >
+inline void btree_set<Key, Compare, Allocator, NodeBytes>::merge_children( inner_node* parent, size_type i, base_node*& track, size_type& track_pos )
+{
+    // children i and i + 1 become one node around separator i
+    base_node* left = parent->children[i];
+    base_node* right = parent->children[i + 1];
+    size_type left_count = left->count;
+
+    place_key(left, left_count, std::move(parent->keys()[i]));
+    for (size_type j = 0; j < right->count; ++j) place_key(left, left->count, std::move(right->keys()[j]));
+
+    if (!left->leaf)
+    {
+        for (size_type j = 0; j <= right->count; ++j)
+        {
+            base_node* moved_child = child(right, j);
+            as_inner(left)->children[left_count + 1 + j] = moved_child;
+            moved_child->parent = as_inner(left);
+            moved_child->position = static_cast<std::uint16_t>(left_count + 1 + j);
+        }
+    }
+
+    std::destroy_n(right->keys(), right->count);
+    right->count = 0;
+
+    for (size_type j = i + 1; j < parent->count; ++j)
+    {
+        parent->children[j] = parent->children[j + 1];
+        parent->children[j]->position = static_cast<std::uint16_t>(j);
+    }
+    remove_key(parent, i);
+
+    if (track == right)
+    {
+        track = left;
+        track_pos += left_count + 1;
+    }
+    if (right == m_rightmost) m_rightmost = left;
+    destroy_node(right);
+}
+
+#endif // !_BTREE_SET_HPP_
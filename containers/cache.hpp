@@ -0,0 +1,440 @@
+#ifndef _CACHE_HPP_
+#define _CACHE_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+
+#include "list.hpp"
+
+
+// Hash index helpers: the index stores references to the keys that already
+// live inside the list nodes, so every key is kept only once.
+template< class Key, class Hash >
+struct key_ref_hash
+{
+    Hash hash;
+    size_t operator () ( std::reference_wrapper<const Key> key ) const { return hash(key.get()); }
+};
+
+template< class Key, class KeyEqual >
+struct key_ref_equal
+{
+    KeyEqual equal;
+    bool operator () ( std::reference_wrapper<const Key> lhs, std::reference_wrapper<const Key> rhs ) const
+    {
+        return equal(lhs.get(), rhs.get());
+    }
+};
+
+
+// Least recently used cache.
+// Entries live in a list ordered from most to least recently used, a hit moves
+// the entry to the front with splice and never allocates.
+template<
+    class Key,
+    class T,
+    class Hash = std::hash<Key>,
+    class KeyEqual = std::equal_to<Key>,
+    class Allocator = std::allocator<std::pair<const Key, T>>
+> class lru_cache
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using eviction_callback = std::function<void( const Key&, T& )>;
+
+private:
+    using entry_list = list<value_type, Allocator>;
+
+public:
+    using iterator = entry_list::iterator;
+    using const_iterator = entry_list::const_iterator;
+
+public:
+    explicit lru_cache( size_type capacity, eviction_callback on_evict = {} );
+    lru_cache( const lru_cache& ) = delete;
+    lru_cache& operator=( const lru_cache& ) = delete;
+
+    // iterators, most recently used first
+    iterator begin() noexcept { return m_entries.begin(); }
+    const_iterator begin() const noexcept { return m_entries.begin(); }
+    iterator end() noexcept { return m_entries.end(); }
+    const_iterator end() const noexcept { return m_entries.end(); }
+
+    // capacity
+    bool empty() const noexcept { return m_index.empty(); }
+    size_type size() const noexcept { return m_index.size(); }
+    size_type capacity() const noexcept { return m_capacity; }
+    void set_capacity( size_type capacity );
+
+    // lookup
+    T* get( const Key& key );
+    const T* peek( const Key& key ) const;
+    bool contains( const Key& key ) const { return m_index.find(std::cref(key)) != m_index.end(); }
+
+    // modifiers
+    template< class... Args >
+    std::pair<T*, bool> try_emplace( const Key& key, Args&&... args );
+
+    void put( const Key& key, const T& value ) { put_impl(key, value); }
+    void put( const Key& key, T&& value ) { put_impl(key, std::move(value)); }
+
+    bool erase( const Key& key );
+    void clear();
+
+    void set_eviction_callback( eviction_callback on_evict ) { m_on_evict = std::move(on_evict); }
+
+private:
+    using index_map = std::unordered_map<
+        std::reference_wrapper<const Key>, iterator,
+        key_ref_hash<Key, Hash>, key_ref_equal<Key, KeyEqual>,
+        typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const std::reference_wrapper<const Key>, iterator>>>;
+
+    template< class V >
+    void put_impl( const Key& key, V&& value );
+
+    void evict_one();
+    void touch( iterator it ) { m_entries.splice(m_entries.begin(), m_entries, it); }
+
+    entry_list m_entries;
+    index_map m_index;
+    size_type m_capacity;
+    eviction_callback m_on_evict;
+};
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline lru_cache<Key, T, Hash, KeyEqual, Allocator>::lru_cache( size_type capacity, eviction_callback on_evict )
+    : m_capacity(capacity), m_on_evict(std::move(on_evict))
+{
+    m_index.reserve(capacity);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lru_cache<Key, T, Hash, KeyEqual, Allocator>::set_capacity( size_type capacity )
+{
+    m_capacity = capacity;
+    while (m_index.size() > m_capacity) evict_one();
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline T* lru_cache<Key, T, Hash, KeyEqual, Allocator>::get( const Key& key )
+{
+    auto found = m_index.find(std::cref(key));
+    if (found == m_index.end()) return nullptr;
+
+    touch(found->second);
+    return &found->second->second;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline const T* lru_cache<Key, T, Hash, KeyEqual, Allocator>::peek( const Key& key ) const
+{
+    auto found = m_index.find(std::cref(key));
+    if (found == m_index.end()) return nullptr;
+
+    return &found->second->second;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+template< class... Args >
+inline std::pair<T*, bool> lru_cache<Key, T, Hash, KeyEqual, Allocator>::try_emplace( const Key& key, Args&&... args )
+{
+    if (T* value = get(key)) return std::make_pair(value, false);
+    if (m_capacity == 0) return std::make_pair(nullptr, false);
+
+    if (m_index.size() >= m_capacity) evict_one();
+
+    m_entries.emplace_front(std::piecewise_construct,
+        std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+    iterator it = m_entries.begin();
+    m_index.emplace(std::cref(it->first), it);
+
+    return std::make_pair(&it->second, true);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+template< class V >
+inline void lru_cache<Key, T, Hash, KeyEqual, Allocator>::put_impl( const Key& key, V&& value )
+{
+    auto [slot, inserted] = try_emplace(key, std::forward<V>(value));
+    if (!inserted && slot != nullptr) *slot = std::forward<V>(value);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline bool lru_cache<Key, T, Hash, KeyEqual, Allocator>::erase( const Key& key )
+{
+    auto found = m_index.find(std::cref(key));
+    if (found == m_index.end()) return false;
+
+    iterator it = found->second;
+    m_index.erase(found);
+    m_entries.erase(it);
+    return true;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lru_cache<Key, T, Hash, KeyEqual, Allocator>::clear()
+{
+    m_index.clear();
+    m_entries.clear();
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lru_cache<Key, T, Hash, KeyEqual, Allocator>::evict_one()
+{
+    iterator victim = std::prev(m_entries.end());
+    if (m_on_evict) m_on_evict(victim->first, victim->second);
+
+    m_index.erase(std::cref(victim->first));
+    m_entries.pop_back();
+}
+
+
+// Least frequently used cache with O(1) operations.
+// Entries are grouped into frequency buckets kept in ascending order, inside a
+// bucket the most recently used entry is at the front. A hit splices the entry
+// into the next bucket. Emptied buckets are parked on a spare list, and an
+// insert tops the spare list up so that there is always one more bucket than
+// entries: a hit then always finds a free bucket and never allocates.
+template<
+    class Key,
+    class T,
+    class Hash = std::hash<Key>,
+    class KeyEqual = std::equal_to<Key>,
+    class Allocator = std::allocator<std::pair<const Key, T>>
+> class lfu_cache
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = size_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using eviction_callback = std::function<void( const Key&, T& )>;
+
+public:
+    explicit lfu_cache( size_type capacity, eviction_callback on_evict = {} );
+    lfu_cache( const lfu_cache& ) = delete;
+    lfu_cache& operator=( const lfu_cache& ) = delete;
+
+    // capacity
+    bool empty() const noexcept { return m_index.empty(); }
+    size_type size() const noexcept { return m_index.size(); }
+    size_type capacity() const noexcept { return m_capacity; }
+    void set_capacity( size_type capacity );
+
+    // lookup
+    T* get( const Key& key );
+    const T* peek( const Key& key ) const;
+    bool contains( const Key& key ) const { return m_index.find(std::cref(key)) != m_index.end(); }
+    size_type frequency( const Key& key ) const;
+
+    // modifiers
+    template< class... Args >
+    std::pair<T*, bool> try_emplace( const Key& key, Args&&... args );
+
+    void put( const Key& key, const T& value ) { put_impl(key, value); }
+    void put( const Key& key, T&& value ) { put_impl(key, std::move(value)); }
+
+    bool erase( const Key& key );
+    void clear();
+
+    void set_eviction_callback( eviction_callback on_evict ) { m_on_evict = std::move(on_evict); }
+
+private:
+    using entry_list = list<value_type, Allocator>;
+    using entry_iter = entry_list::iterator;
+
+    struct bucket
+    {
+        size_type freq;
+        entry_list entries;
+
+        bucket( size_type _freq ) : freq(_freq) {}
+    };
+
+    using bucket_list = list<bucket, typename std::allocator_traits<Allocator>::template rebind_alloc<bucket>>;
+    using bucket_iter = bucket_list::iterator;
+
+    struct slot
+    {
+        entry_iter entry;
+        bucket_iter owner;
+    };
+
+    using index_map = std::unordered_map<
+        std::reference_wrapper<const Key>, slot,
+        key_ref_hash<Key, Hash>, key_ref_equal<Key, KeyEqual>,
+        typename std::allocator_traits<Allocator>::template rebind_alloc<std::pair<const std::reference_wrapper<const Key>, slot>>>;
+
+    template< class V >
+    void put_impl( const Key& key, V&& value );
+
+    bucket_iter bucket_before( bucket_iter pos, size_type freq );
+    void release_if_empty( bucket_iter b );
+    void touch( slot& s );
+    void evict_one();
+
+    bucket_list m_buckets;
+    bucket_list m_spare;
+    size_type m_bucket_count = 0;
+    index_map m_index;
+    size_type m_capacity;
+    eviction_callback m_on_evict;
+};
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline lfu_cache<Key, T, Hash, KeyEqual, Allocator>::lfu_cache( size_type capacity, eviction_callback on_evict )
+    : m_capacity(capacity), m_on_evict(std::move(on_evict))
+{
+    m_index.reserve(capacity);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lfu_cache<Key, T, Hash, KeyEqual, Allocator>::set_capacity( size_type capacity )
+{
+    m_capacity = capacity;
+    while (m_index.size() > m_capacity) evict_one();
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline lfu_cache<Key, T, Hash, KeyEqual, Allocator>::bucket_iter
+lfu_cache<Key, T, Hash, KeyEqual, Allocator>::bucket_before( bucket_iter pos, size_type freq )
+{
+    if (pos != m_buckets.end() && pos->freq == freq) return pos;
+
+    if (m_spare.empty())
+    {
+        ++m_bucket_count;
+        return m_buckets.emplace(pos, freq);
+    }
+
+    bucket_iter reused = m_spare.begin();
+    m_buckets.splice(pos, m_spare, reused);
+    reused->freq = freq;
+    return reused;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lfu_cache<Key, T, Hash, KeyEqual, Allocator>::release_if_empty( bucket_iter b )
+{
+    if (b->entries.empty()) m_spare.splice(m_spare.begin(), m_buckets, b);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lfu_cache<Key, T, Hash, KeyEqual, Allocator>::touch( slot& s )
+{
+    bucket_iter from = s.owner;
+    bucket_iter to = bucket_before(std::next(from), from->freq + 1);
+
+    to->entries.splice(to->entries.begin(), from->entries, s.entry);
+    s.owner = to;
+
+    release_if_empty(from);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline T* lfu_cache<Key, T, Hash, KeyEqual, Allocator>::get( const Key& key )
+{
+    auto found = m_index.find(std::cref(key));
+    if (found == m_index.end()) return nullptr;
+
+    touch(found->second);
+    return &found->second.entry->second;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline const T* lfu_cache<Key, T, Hash, KeyEqual, Allocator>::peek( const Key& key ) const
+{
+    auto found = m_index.find(std::cref(key));
+    if (found == m_index.end()) return nullptr;
+
+    return &found->second.entry->second;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline lfu_cache<Key, T, Hash, KeyEqual, Allocator>::size_type
+lfu_cache<Key, T, Hash, KeyEqual, Allocator>::frequency( const Key& key ) const
+{
+    auto found = m_index.find(std::cref(key));
+    return found == m_index.end() ? 0 : found->second.owner->freq;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+template< class... Args >
+inline std::pair<T*, bool> lfu_cache<Key, T, Hash, KeyEqual, Allocator>::try_emplace( const Key& key, Args&&... args )
+{
+    if (T* value = get(key)) return std::make_pair(value, false);
+    if (m_capacity == 0) return std::make_pair(nullptr, false);
+
+    if (m_index.size() >= m_capacity) evict_one();
+
+    // live buckets never outnumber entries, so this keeps a spare for every hit
+    while (m_bucket_count < m_index.size() + 2)
+    {
+        m_spare.emplace_front(0);
+        ++m_bucket_count;
+    }
+
+    bucket_iter first = bucket_before(m_buckets.begin(), 1);
+    first->entries.emplace_front(std::piecewise_construct,
+        std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+
+    entry_iter it = first->entries.begin();
+    m_index.emplace(std::cref(it->first), slot{ it, first });
+
+    return std::make_pair(&it->second, true);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+template< class V >
+inline void lfu_cache<Key, T, Hash, KeyEqual, Allocator>::put_impl( const Key& key, V&& value )
+{
+    auto [slot, inserted] = try_emplace(key, std::forward<V>(value));
+    if (!inserted && slot != nullptr) *slot = std::forward<V>(value);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline bool lfu_cache<Key, T, Hash, KeyEqual, Allocator>::erase( const Key& key )
+{
+    auto found = m_index.find(std::cref(key));
+    if (found == m_index.end()) return false;
+
+    slot s = found->second;
+    m_index.erase(found);
+    s.owner->entries.erase(s.entry);
+    release_if_empty(s.owner);
+    return true;
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lfu_cache<Key, T, Hash, KeyEqual, Allocator>::clear()
+{
+    m_index.clear();
+    for (auto& b : m_buckets) b.entries.clear();
+    m_spare.splice(m_spare.begin(), m_buckets);
+}
+
+template< class Key, class T, class Hash, class KeyEqual, class Allocator >
+inline void lfu_cache<Key, T, Hash, KeyEqual, Allocator>::evict_one()
+{
+    bucket_iter coldest = m_buckets.begin();
+    entry_iter victim = std::prev(coldest->entries.end());
+    if (m_on_evict) m_on_evict(victim->first, victim->second);
+
+    m_index.erase(std::cref(victim->first));
+    coldest->entries.pop_back();
+    release_if_empty(coldest);
+}
+
+#endif // !_CACHE_HPP_
@@ -0,0 +1,745 @@
+#ifndef _COMPACT_LIST_HPP_
+#define _COMPACT_LIST_HPP_
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// Doubly linked list whose nodes live in one contiguous arena and are linked by
+// 32-bit indices instead of pointers. Slot 0 of the arena is the sentinel, so
+// end() is index 0. Erased slots go to a free list and are reused by later
+// inserts. Iterators hold (container, index) and growing the arena keeps every
+// index, so they stay valid until their element is erased. Only shrink_to_fit
+// renumbers the nodes.
+template< class T, class Allocator = std::allocator<T> >
+class compact_list
+{
+private:
+    class index_iter;
+    struct node;
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = size_t;
+    using difference_type = ptrdiff_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = std::allocator_traits<Allocator>::pointer;
+    using const_pointer = std::allocator_traits<Allocator>::const_pointer;
+    using iterator = index_iter;
+    using const_iterator = const index_iter;
+    using reverse_iterator = std::reverse_iterator<iterator>;
+    using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+    using index_type = std::uint32_t;
+
+public:
+    // ctors and dctor
+    compact_list() = default;
+    explicit compact_list( const Allocator& alloc ) : m_alloc(alloc) {}
+    compact_list( size_type count, const T& value, const Allocator& alloc = Allocator() );
+    explicit compact_list( size_type count, const Allocator& alloc = Allocator() );
+    template< std::input_iterator InputIt >
+    compact_list( InputIt first, InputIt last, const Allocator& alloc = Allocator() );
+    compact_list( const compact_list& other );
+    compact_list( compact_list&& other ) noexcept;
+    compact_list( std::initializer_list<T> init, const Allocator& alloc = Allocator() );
+    ~compact_list();
+
+    // assignment operator
+    compact_list& operator=( const compact_list& other );
+    compact_list& operator=( compact_list&& other ) noexcept;
+    compact_list& operator=( std::initializer_list<value_type> ilist );
+
+    allocator_type get_allocator() const noexcept { return m_alloc; }
+
+    // element access
+    reference front() { return m_nodes[m_nodes[0].next].value; }
+    const_reference front() const { return m_nodes[m_nodes[0].next].value; }
+
+    reference back() { return m_nodes[m_nodes[0].prev].value; }
+    const_reference back() const { return m_nodes[m_nodes[0].prev].value; }
+
+    // iterators
+    iterator begin() noexcept { return iterator(this, first_index()); }
+    const_iterator begin() const noexcept { return const_iterator(const_cast<compact_list*>(this), first_index()); }
+    const_iterator cbegin() const noexcept { return begin(); }
+
+    iterator end() noexcept { return iterator(this, 0); }
+    const_iterator end() const noexcept { return const_iterator(const_cast<compact_list*>(this), 0); }
+    const_iterator cend() const noexcept { return end(); }
+
+    reverse_iterator rbegin() noexcept { return reverse_iterator(end()); }
+    const_reverse_iterator rbegin() const noexcept { return const_reverse_iterator(end()); }
+    reverse_iterator rend() noexcept { return reverse_iterator(begin()); }
+    const_reverse_iterator rend() const noexcept { return const_reverse_iterator(begin()); }
+
+    // capacity
+    bool empty() const noexcept { return m_size == 0; }
+    size_type size() const noexcept { return m_size; }
+    size_type max_size() const noexcept { return std::numeric_limits<index_type>::max() - 1; }
+    size_type capacity() const noexcept { return m_capacity == 0 ? 0 : m_capacity - 1; }
+    void reserve( size_type new_cap );
+    void shrink_to_fit();
+
+    // modifiers
+    void clear() noexcept;
+
+    iterator insert( const_iterator pos, const T& value ) { return emplace(pos, value); }
+    iterator insert( const_iterator pos, T&& value ) { return emplace(pos, std::move(value)); }
+    iterator insert( const_iterator pos, size_type count, const T& value );
+    template< std::input_iterator InputIt >
+    iterator insert( const_iterator pos, InputIt first, InputIt last );
+    iterator insert( const_iterator pos, std::initializer_list<T> ilist ) { return insert(pos, ilist.begin(), ilist.end()); }
+
+    template< class... Args >
+    iterator emplace( const_iterator pos, Args&&... args );
+
+    iterator erase( const_iterator pos );
+    iterator erase( const_iterator first, const_iterator last );
+
+    void push_back( const T& value ) { emplace(end(), value); }
+    void push_back( T&& value ) { emplace(end(), std::move(value)); }
+    template< class... Args >
+    reference emplace_back( Args&&... args ) { return *emplace(end(), std::forward<Args>(args)...); }
+    void pop_back() { if (!empty()) erase(iterator(this, m_nodes[0].prev)); }
+
+    void push_front( const T& value ) { emplace(begin(), value); }
+    void push_front( T&& value ) { emplace(begin(), std::move(value)); }
+    template< class... Args >
+    reference emplace_front( Args&&... args ) { return *emplace(begin(), std::forward<Args>(args)...); }
+    void pop_front() { if (!empty()) erase(begin()); }
+
+    void resize( size_type count ) { resize(count, T()); }
+    void resize( size_type count, const value_type& value );
+
+    void swap( compact_list& other ) noexcept;
+
+    // operations
+    // within one container splice only relinks indices, across containers the
+    // elements are moved into this arena and iterators into other are invalidated
+    void splice( const_iterator pos, compact_list& other );
+    void splice( const_iterator pos, compact_list& other, const_iterator it );
+    void splice( const_iterator pos, compact_list& other, const_iterator first, const_iterator last );
+
+    size_type remove( const T& value );
+    template< class UnaryPredicate >
+    size_type remove_if( UnaryPredicate p );
+
+    void reverse() noexcept;
+
+    size_type unique() { return unique(std::equal_to<T>()); }
+    template< class BinaryPredicate >
+    size_type unique( BinaryPredicate p );
+
+    void sort() { sort(std::less<T>()); }
+    template< class Compare >
+    void sort( Compare comp );
+
+private:
+    struct node
+    {
+        index_type next;
+        index_type prev;
+        union { T value; };
+
+        node() : next(0), prev(0) {}
+        ~node() {}
+    };
+
+    class index_iter
+    {
+    private:
+        friend class compact_list;
+
+    public:
+        using iterator_type = compact_list::value_type;
+        using value_type = iterator_type;
+        using difference_type = ptrdiff_t;
+        using reference = value_type&;
+        using pointer = value_type*;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+    private:
+        index_iter( compact_list* owner, index_type index ) : m_owner(owner), m_index(index) {}
+
+        compact_list* m_owner = nullptr;
+        index_type m_index = 0;
+
+    public:
+        index_iter() = default;
+
+        reference operator * () const noexcept { return m_owner->m_nodes[m_index].value; }
+        pointer operator -> () const noexcept { return &m_owner->m_nodes[m_index].value; }
+
+        index_iter& operator ++ () noexcept { m_index = m_owner->m_nodes[m_index].next; return *this; }
+        index_iter operator ++ (int) noexcept { index_iter tmp = *this; ++(*this); return tmp; }
+        index_iter& operator -- () noexcept { m_index = m_owner->m_nodes[m_index].prev; return *this; }
+        index_iter operator -- (int) noexcept { index_iter tmp = *this; --(*this); return tmp; }
+
+        bool operator == ( const index_iter& other ) const noexcept { return m_index == other.m_index; }
+        bool operator != ( const index_iter& other ) const noexcept { return m_index != other.m_index; }
+    };
+
+    static constexpr index_type no_index = std::numeric_limits<index_type>::max();
+
+    index_type first_index() const noexcept { return m_nodes ? m_nodes[0].next : 0; }
+
+    node* allocate_arena( size_type capacity );
+    size_type grown_capacity() const;
+    void relocate( node* fresh, size_type new_capacity );
+    void compact( size_type new_capacity );
+    void release_slot( index_type index ) noexcept;
+
+    void link_before( index_type pos, index_type index ) noexcept;
+    void unlink( index_type index ) noexcept;
+    void destroy_all() noexcept;
+
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<node>;
+
+    node_allocator m_alloc;
+    node* m_nodes = nullptr;
+    index_type m_capacity = 0;
+    index_type m_used = 0;
+    index_type m_free = no_index;
+    size_type m_size = 0;
+};
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::compact_list( size_type count, const T& value, const Allocator& alloc ) : m_alloc(alloc)
+{
+    insert(end(), count, value);
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::compact_list( size_type count, const Allocator& alloc ) : m_alloc(alloc)
+{
+    reserve(count);
+    for (size_type i = 0; i < count; ++i) emplace_back();
+}
+
+template< class T, class Allocator >
+template< std::input_iterator InputIt >
+inline compact_list<T, Allocator>::compact_list( InputIt first, InputIt last, const Allocator& alloc ) : m_alloc(alloc)
+{
+    insert(end(), first, last);
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::compact_list( const compact_list& other )
+    : m_alloc(node_allocator_traits::select_on_container_copy_construction(other.m_alloc))
+{
+    reserve(other.size());
+    insert(end(), other.begin(), other.end());
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::compact_list( compact_list&& other ) noexcept
+    : m_alloc(std::move(other.m_alloc)), m_nodes(other.m_nodes), m_capacity(other.m_capacity),
+      m_used(other.m_used), m_free(other.m_free), m_size(other.m_size)
+{
+    other.m_nodes = nullptr;
+    other.m_capacity = 0;
+    other.m_used = 0;
+    other.m_free = no_index;
+    other.m_size = 0;
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::compact_list( std::initializer_list<T> init, const Allocator& alloc ) : m_alloc(alloc)
+{
+    insert(end(), init.begin(), init.end());
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::~compact_list()
+{
+    destroy_all();
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>& compact_list<T, Allocator>::operator=( const compact_list& other )
+{
+    if (this == &other) return *this;
+
+    clear();
+    reserve(other.size());
+    insert(end(), other.begin(), other.end());
+    return *this;
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>& compact_list<T, Allocator>::operator=( compact_list&& other ) noexcept
+{
+    if (this == &other) return *this;
+
+    destroy_all();
+    m_alloc = std::move(other.m_alloc);
+    m_nodes = std::exchange(other.m_nodes, nullptr);
+    m_capacity = std::exchange(other.m_capacity, 0);
+    m_used = std::exchange(other.m_used, 0);
+    m_free = std::exchange(other.m_free, no_index);
+    m_size = std::exchange(other.m_size, 0);
+    return *this;
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>& compact_list<T, Allocator>::operator=( std::initializer_list<value_type> ilist )
+{
+    clear();
+    insert(end(), ilist.begin(), ilist.end());
+    return *this;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::reserve( size_type new_cap )
+{
+    if (new_cap > max_size()) throw std::length_error("compact_list::reserve");
+    if (new_cap + 1 <= m_capacity) return;
+
+    node* fresh = allocate_arena(new_cap + 1);
+    try
+    {
+        relocate(fresh, new_cap + 1);
+    }
+    catch (...)
+    {
+        node_allocator_traits::deallocate(m_alloc, fresh, new_cap + 1);
+        throw;
+    }
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::shrink_to_fit()
+{
+    if (m_nodes == nullptr) return;
+
+    if (m_size == 0) destroy_all();
+    else if (m_size + 1 < m_capacity) compact(m_size + 1);
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::node* compact_list<T, Allocator>::allocate_arena( size_type capacity )
+{
+    node* fresh = node_allocator_traits::allocate(m_alloc, capacity);
+    node_allocator_traits::construct(m_alloc, fresh);
+    return fresh;
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::size_type compact_list<T, Allocator>::grown_capacity() const
+{
+    if (m_size >= max_size()) throw std::length_error("compact_list: index space exhausted");
+
+    size_type grown = m_capacity < 8 ? 8 : size_type(m_capacity) * 2;
+    return std::min<size_type>(grown, max_size() + 1);
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::relocate( node* fresh, size_type new_capacity )
+{
+    // every slot keeps its index, so iterators and the free list stay valid
+    if (m_nodes != nullptr)
+    {
+        for (index_type i = 1; i < m_used; ++i) node_allocator_traits::construct(m_alloc, fresh + i);
+        for (index_type i = 0; i < m_used; ++i)
+        {
+            fresh[i].next = m_nodes[i].next;
+            fresh[i].prev = m_nodes[i].prev;
+        }
+
+        // values are copied unless their move cannot throw, so a throwing copy
+        // leaves the old arena untouched; the caller still owns fresh
+        index_type built = m_nodes[0].next;
+        try
+        {
+            for (; built != 0; built = m_nodes[built].next)
+                node_allocator_traits::construct(m_alloc, &fresh[built].value, std::move_if_noexcept(m_nodes[built].value));
+        }
+        catch (...)
+        {
+            for (index_type i = m_nodes[0].next; i != built; i = m_nodes[i].next)
+                node_allocator_traits::destroy(m_alloc, &fresh[i].value);
+            for (index_type i = 1; i < m_used; ++i) node_allocator_traits::destroy(m_alloc, fresh + i);
+            throw;
+        }
+
+        for (index_type i = m_nodes[0].next; i != 0; i = m_nodes[i].next)
+            node_allocator_traits::destroy(m_alloc, &m_nodes[i].value);
+
+        for (index_type i = 0; i < m_used; ++i) node_allocator_traits::destroy(m_alloc, m_nodes + i);
+        node_allocator_traits::deallocate(m_alloc, m_nodes, m_capacity);
+    }
+    else m_used = 1;
+
+    m_nodes = fresh;
+    m_capacity = static_cast<index_type>(new_capacity);
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::compact( size_type new_capacity )
+{
+    node* fresh = allocate_arena(new_capacity);
+
+    // live elements are renumbered in list order, which also restores locality
+    index_type count = 0;
+    try
+    {
+        for (index_type i = m_nodes[0].next; i != 0; i = m_nodes[i].next)
+        {
+            node_allocator_traits::construct(m_alloc, fresh + count + 1);
+            node_allocator_traits::construct(m_alloc, &fresh[count + 1].value, std::move_if_noexcept(m_nodes[i].value));
+            ++count;
+            fresh[count].prev = count - 1;
+            fresh[count - 1].next = count;
+        }
+    }
+    catch (...)
+    {
+        for (index_type i = count; i > 0; --i) node_allocator_traits::destroy(m_alloc, &fresh[i].value);
+        node_allocator_traits::deallocate(m_alloc, fresh, new_capacity);
+        throw;
+    }
+    fresh[count].next = 0;
+    fresh[0].prev = count;
+
+    destroy_all();
+
+    m_nodes = fresh;
+    m_capacity = static_cast<index_type>(new_capacity);
+    m_used = count + 1;
+    m_size = count;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::release_slot( index_type index ) noexcept
+{
+    node_allocator_traits::destroy(m_alloc, &m_nodes[index].value);
+    m_nodes[index].next = m_free;
+    m_free = index;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::link_before( index_type pos, index_type index ) noexcept
+{
+    index_type prev = m_nodes[pos].prev;
+
+    m_nodes[index].prev = prev;
+    m_nodes[index].next = pos;
+    m_nodes[prev].next = index;
+    m_nodes[pos].prev = index;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::unlink( index_type index ) noexcept
+{
+    m_nodes[m_nodes[index].prev].next = m_nodes[index].next;
+    m_nodes[m_nodes[index].next].prev = m_nodes[index].prev;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::destroy_all() noexcept
+{
+    if (m_nodes == nullptr) return;
+
+    for (index_type i = m_nodes[0].next; i != 0; i = m_nodes[i].next)
+        node_allocator_traits::destroy(m_alloc, &m_nodes[i].value);
+
+    for (index_type i = 0; i < m_used; ++i) node_allocator_traits::destroy(m_alloc, m_nodes + i);
+    node_allocator_traits::deallocate(m_alloc, m_nodes, m_capacity);
+
+    m_nodes = nullptr;
+    m_capacity = 0;
+    m_used = 0;
+    m_free = no_index;
+    m_size = 0;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::clear() noexcept
+{
+    if (m_nodes == nullptr) return;
+
+    if constexpr (!std::is_trivially_destructible_v<T>)
+    {
+        for (index_type i = m_nodes[0].next; i != 0; i = m_nodes[i].next)
+            node_allocator_traits::destroy(m_alloc, &m_nodes[i].value);
+    }
+
+    // every slot is free again, the untouched tail is handed out by m_used
+    m_nodes[0].next = 0;
+    m_nodes[0].prev = 0;
+    m_used = 1;
+    m_free = no_index;
+    m_size = 0;
+}
+
+template< class T, class Allocator >
+template< class... Args >
+inline compact_list<T, Allocator>::iterator compact_list<T, Allocator>::emplace( const_iterator pos, Args&&... args )
+{
+    index_type index;
+
+    if (m_free != no_index)
+    {
+        index = m_free;
+        node_allocator_traits::construct(m_alloc, &m_nodes[index].value, std::forward<Args>(args)...);
+        m_free = m_nodes[index].next;
+    }
+    else if (m_used < m_capacity)
+    {
+        index = m_used;
+        node_allocator_traits::construct(m_alloc, m_nodes + index);
+        node_allocator_traits::construct(m_alloc, &m_nodes[index].value, std::forward<Args>(args)...);
+        ++m_used;
+    }
+    else
+    {
+        // build the new element before the move, args may refer into the old arena
+        size_type new_capacity = grown_capacity();
+        node* fresh = allocate_arena(new_capacity);
+        index = m_nodes == nullptr ? 1 : m_used;
+
+        try
+        {
+            node_allocator_traits::construct(m_alloc, fresh + index);
+            node_allocator_traits::construct(m_alloc, &fresh[index].value, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            node_allocator_traits::deallocate(m_alloc, fresh, new_capacity);
+            throw;
+        }
+
+        try
+        {
+            relocate(fresh, new_capacity);
+        }
+        catch (...)
+        {
+            node_allocator_traits::destroy(m_alloc, &fresh[index].value);
+            node_allocator_traits::deallocate(m_alloc, fresh, new_capacity);
+            throw;
+        }
+        ++m_used;
+    }
+
+    link_before(pos.m_index, index);
+    ++m_size;
+    return iterator(this, index);
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::iterator compact_list<T, Allocator>::insert( const_iterator pos, size_type count, const T& value )
+{
+    if (count == 0) return iterator(this, pos.m_index);
+
+    reserve(m_size + count);
+    iterator first = emplace(pos, value);
+    for (size_type i = 1; i < count; ++i) emplace(pos, value);
+    return first;
+}
+
+template< class T, class Allocator >
+template< std::input_iterator InputIt >
+inline compact_list<T, Allocator>::iterator compact_list<T, Allocator>::insert( const_iterator pos, InputIt first, InputIt last )
+{
+    if constexpr (std::forward_iterator<InputIt>)
+        reserve(m_size + static_cast<size_type>(std::distance(first, last)));
+
+    if (first == last) return iterator(this, pos.m_index);
+
+    iterator result = emplace(pos, *first);
+    for (++first; first != last; ++first) emplace(pos, *first);
+    return result;
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::iterator compact_list<T, Allocator>::erase( const_iterator pos )
+{
+    index_type index = pos.m_index;
+    if (index == 0) return end();
+
+    index_type next = m_nodes[index].next;
+    unlink(index);
+    release_slot(index);
+    --m_size;
+    return iterator(this, next);
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::iterator compact_list<T, Allocator>::erase( const_iterator first, const_iterator last )
+{
+    iterator it(this, first.m_index);
+    while (it != last) it = erase(it);
+    return it;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::resize( size_type count, const value_type& value )
+{
+    while (m_size > count) pop_back();
+    if (m_size < count) insert(end(), count - m_size, value);
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::swap( compact_list& other ) noexcept
+{
+    using std::swap;
+    if constexpr (node_allocator_traits::propagate_on_container_swap::value) swap(m_alloc, other.m_alloc);
+    swap(m_nodes, other.m_nodes);
+    swap(m_capacity, other.m_capacity);
+    swap(m_used, other.m_used);
+    swap(m_free, other.m_free);
+    swap(m_size, other.m_size);
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::splice( const_iterator pos, compact_list& other )
+{
+    splice(pos, other, other.begin(), other.end());
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::splice( const_iterator pos, compact_list& other, const_iterator it )
+{
+    if (this != &other)
+    {
+        emplace(pos, std::move(*it));
+        other.erase(it);
+        return;
+    }
+
+    index_type index = it.m_index;
+    if (pos.m_index == index || pos.m_index == m_nodes[index].next) return;
+
+    unlink(index);
+    link_before(pos.m_index, index);
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::splice( const_iterator pos, compact_list& other, const_iterator first, const_iterator last )
+{
+    if (first == last) return;
+
+    if (this != &other)
+    {
+        iterator it(&other, first.m_index);
+        while (it != last)
+        {
+            emplace(pos, std::move(*it));
+            it = other.erase(it);
+        }
+        return;
+    }
+
+    // detach [first, last) as one chain and relink it before pos
+    index_type head = first.m_index;
+    index_type tail = m_nodes[last.m_index].prev;
+
+    m_nodes[m_nodes[head].prev].next = last.m_index;
+    m_nodes[last.m_index].prev = m_nodes[head].prev;
+
+    index_type before = m_nodes[pos.m_index].prev;
+    m_nodes[before].next = head;
+    m_nodes[head].prev = before;
+    m_nodes[tail].next = pos.m_index;
+    m_nodes[pos.m_index].prev = tail;
+}
+
+template< class T, class Allocator >
+inline compact_list<T, Allocator>::size_type compact_list<T, Allocator>::remove( const T& value )
+{
+    // value may alias an element, compare against a copy
+    const T copy = value;
+    return remove_if([&copy](const T& elem) { return elem == copy; });
+}
+
+template< class T, class Allocator >
+template< class UnaryPredicate >
+inline compact_list<T, Allocator>::size_type compact_list<T, Allocator>::remove_if( UnaryPredicate p )
+{
+    size_type counter = 0;
+    for (auto it = begin(); it != end();)
+    {
+        if (p(*it))
+        {
+            it = erase(it);
+            ++counter;
+        }
+        else ++it;
+    }
+    return counter;
+}
+
+template< class T, class Allocator >
+inline void compact_list<T, Allocator>::reverse() noexcept
+{
+    if (m_nodes == nullptr) return;
+
+    index_type index = 0;
+    do
+    {
+        std::swap(m_nodes[index].next, m_nodes[index].prev);
+        index = m_nodes[index].prev;
+    }
+    while (index != 0);
+}
+
+template< class T, class Allocator >
+template< class BinaryPredicate >
+inline compact_list<T, Allocator>::size_type compact_list<T, Allocator>::unique( BinaryPredicate p )
+{
+    if (empty()) return 0;
+
+    size_type counter = 0;
+    for (auto kept = begin(), it = std::next(kept); it != end();)
+    {
+        if (p(*kept, *it))
+        {
+            it = erase(it);
+            ++counter;
+        }
+        else kept = it++;
+    }
+    return counter;
+}
+
+template< class T, class Allocator >
+template< class Compare >
+inline void compact_list<T, Allocator>::sort( Compare comp )
+{
+    if (m_size < 2) return;
+
+    // sort the indices, then rebuild the links in one pass
+    std::vector<index_type> order;
+    order.reserve(m_size);
+    for (index_type i = m_nodes[0].next; i != 0; i = m_nodes[i].next) order.push_back(i);
+
+    std::stable_sort(order.begin(), order.end(),
+        [this, &comp](index_type lhs, index_type rhs) { return comp(m_nodes[lhs].value, m_nodes[rhs].value); });
+
+    index_type prev = 0;
+    for (index_type index : order)
+    {
+        m_nodes[prev].next = index;
+        m_nodes[index].prev = prev;
+        prev = index;
+    }
+    m_nodes[prev].next = 0;
+    m_nodes[0].prev = prev;
+}
+
+#endif // !_COMPACT_LIST_HPP_
@@ -0,0 +1,814 @@
+#ifndef _COMPACT_SET_HPP_
+#define _COMPACT_SET_HPP_
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// set's AVL tree laid out for memory: nodes live in one contiguous arena and
+// are linked by 32-bit indices, the subtree height is packed into the top bits
+// of the left link and there is no parent link. A set<int> node is 12 bytes
+// with no per-node malloc overhead, against 40 bytes plus overhead for set.
+// Slot 0 is the null node with height 0, so the balancing code never tests for
+// a missing child. Erased slots go to a free list, as in compact_list.
+//
+// Without parent links iterators carry the path from the root, so they are
+// forward only and any insert or erase invalidates them; erase(pos) hands back
+// a fresh iterator to the next key.
+template< class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key> >
+class compact_set
+{
+private:
+    class path_iter;
+    struct node;
+
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using reference = const Key&;
+    using const_reference = const Key&;
+    using iterator = path_iter;
+    using const_iterator = path_iter;
+    using index_type = std::uint32_t;
+
+    // 26 index bits leave 6 for the height, and an AVL tree of 2^26 nodes is at
+    // most 38 levels deep
+    static constexpr unsigned index_bits = 26;
+    static constexpr int max_depth = 40;
+
+public:
+    // constructors and destructor
+    compact_set() = default;
+    explicit compact_set( const Compare& comp, const Allocator& alloc = Allocator() ) : m_comp(comp), m_alloc(alloc) {}
+    explicit compact_set( const Allocator& alloc ) : m_alloc(alloc) {}
+    template< std::input_iterator InputIt >
+    compact_set( InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator() );
+    compact_set( std::initializer_list<Key> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator() )
+        : compact_set(init.begin(), init.end(), comp, alloc) {}
+    compact_set( const compact_set& other );
+    compact_set( compact_set&& other ) noexcept;
+    ~compact_set() { destroy_all(); }
+
+    // assignment operators
+    compact_set& operator=( const compact_set& other );
+    compact_set& operator=( compact_set&& other ) noexcept;
+
+    allocator_type get_allocator() const noexcept { return allocator_type(m_alloc); }
+
+    // iterators
+    iterator begin() const;
+    iterator cbegin() const { return begin(); }
+    iterator end() const { return iterator(this); }
+    iterator cend() const { return end(); }
+
+    // capacity
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    size_type size() const noexcept { return m_size; }
+    size_type max_size() const noexcept { return index_mask; }
+    size_type capacity() const noexcept { return m_capacity == 0 ? 0 : m_capacity - 1; }
+    void reserve( size_type new_cap );
+    // renumbers the nodes in key order, which also restores locality
+    void shrink_to_fit();
+
+    // modifiers
+    void clear() noexcept;
+
+    std::pair<iterator, bool> insert( const value_type& key ) { return emplace(key); }
+    std::pair<iterator, bool> insert( value_type&& key ) { return emplace(std::move(key)); }
+    template< class... Args >
+    std::pair<iterator, bool> emplace( Args&&... args );
+
+    iterator erase( const_iterator pos );
+    size_type erase( const key_type& key );
+
+    void swap( compact_set& other ) noexcept;
+
+    // lookup
+    iterator find( const key_type& key ) const;
+    bool contains( const key_type& key ) const;
+    size_type count( const key_type& key ) const { return contains(key) ? 1 : 0; }
+    iterator lower_bound( const key_type& key ) const;
+    iterator upper_bound( const key_type& key ) const;
+
+    // calls fn(key) in order for every key in [lo, hi)
+    template< class Fn >
+    void for_each_in_range( const key_type& lo, const key_type& hi, Fn fn ) const;
+
+    // observers
+    key_compare key_comp() const { return m_comp; }
+    value_compare value_comp() const { return m_comp; }
+
+private:
+    static constexpr index_type index_mask = (index_type(1) << index_bits) - 1;
+
+    struct node
+    {
+        index_type left_height;
+        index_type right;
+        union { Key key; };
+
+        node() : left_height(0), right(0) {}
+        ~node() {}
+    };
+
+    class path_iter
+    {
+    private:
+        friend class compact_set;
+
+    public:
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using reference = const Key&;
+        using pointer = const Key*;
+        using iterator_category = std::forward_iterator_tag;
+
+    private:
+        explicit path_iter( const compact_set* owner ) : m_owner(owner) {}
+
+        void push_left( index_type index )
+        {
+            for (; index != 0; index = m_owner->left(index)) m_path[m_depth++] = index;
+        }
+
+        index_type current() const { return m_depth == 0 ? 0 : m_path[m_depth - 1]; }
+
+        const compact_set* m_owner = nullptr;
+        int m_depth = 0;
+        // the nodes whose key and right subtree are still ahead, innermost last
+        index_type m_path[max_depth];
+
+    public:
+        path_iter() = default;
+
+        reference operator * () const noexcept { return m_owner->m_nodes[current()].key; }
+        pointer operator -> () const noexcept { return &m_owner->m_nodes[current()].key; }
+
+        path_iter& operator ++ ()
+        {
+            index_type done = m_path[--m_depth];
+            push_left(m_owner->m_nodes[done].right);
+            return *this;
+        }
+        path_iter operator ++ (int) { path_iter tmp = *this; ++(*this); return tmp; }
+
+        bool operator == ( const path_iter& other ) const noexcept { return current() == other.current(); }
+        bool operator != ( const path_iter& other ) const noexcept { return current() != other.current(); }
+    };
+
+    // packed link accessors, slot 0 reads as an empty subtree
+    index_type left( index_type index ) const { return m_nodes[index].left_height & index_mask; }
+    index_type right( index_type index ) const { return m_nodes[index].right; }
+    int height( index_type index ) const { return static_cast<int>(m_nodes[index].left_height >> index_bits); }
+    const Key& key_at( index_type index ) const { return m_nodes[index].key; }
+
+    void set_left( index_type index, index_type child )
+    {
+        m_nodes[index].left_height = (m_nodes[index].left_height & ~index_mask) | child;
+    }
+
+    void fix_height( index_type index )
+    {
+        index_type h = 1 + std::max(height(left(index)), height(right(index)));
+        m_nodes[index].left_height = left(index) | (h << index_bits);
+    }
+
+    // subtrees are passed and returned by root index, rebalanced on the way up
+    index_type rotate_left( index_type index );
+    index_type rotate_right( index_type index );
+    index_type balance( index_type index );
+    index_type insert_at( index_type index, index_type fresh, index_type& found );
+    index_type erase_at( index_type index, const key_type& key, bool& erased );
+    index_type remove_min( index_type index, index_type& min );
+
+    template< class ForwardIt >
+    index_type build_sorted( ForwardIt& it, size_type count );
+    template< class ForwardIt >
+    void assign_sorted( ForwardIt first, size_type count );
+    template< class F >
+    void for_each_node( index_type index, F& f ) const;
+
+    node* allocate_arena( size_type capacity );
+    size_type grown_capacity() const;
+    void relocate( node* fresh, size_type new_capacity );
+    template< class... Args >
+    index_type acquire_slot( Args&&... args );
+    void release_slot( index_type index ) noexcept;
+    void destroy_all() noexcept;
+
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<node>;
+
+    node* m_nodes = nullptr;
+    index_type m_root = 0;
+    index_type m_capacity = 0;
+    index_type m_used = 0;
+    // free slots are chained through right, 0 ends the chain
+    index_type m_free = 0;
+    size_type m_size = 0;
+    [[no_unique_address]] Compare m_comp;
+    [[no_unique_address]] node_allocator m_alloc;
+};
+
+template< class Key, class Compare, class Allocator >
+template< std::input_iterator InputIt >
+inline compact_set<Key, Compare, Allocator>::compact_set( InputIt first, InputIt last, const Compare& comp, const Allocator& alloc )
+    : m_comp(comp), m_alloc(alloc)
+{
+    // sorted and deduplicated up front, then built in O(n) like set does
+    std::vector<Key> keys(first, last);
+    std::stable_sort(keys.begin(), keys.end(), m_comp);
+    auto same = [this]( const Key& a, const Key& b ) { return !m_comp(a, b) && !m_comp(b, a); };
+    keys.erase(std::unique(keys.begin(), keys.end(), same), keys.end());
+
+    assign_sorted(std::make_move_iterator(keys.begin()), keys.size());
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::compact_set( const compact_set& other )
+    : m_comp(other.m_comp), m_alloc(node_allocator_traits::select_on_container_copy_construction(other.m_alloc))
+{
+    assign_sorted(other.begin(), other.size());
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::compact_set( compact_set&& other ) noexcept
+    : m_nodes(std::exchange(other.m_nodes, nullptr)), m_root(std::exchange(other.m_root, 0)),
+      m_capacity(std::exchange(other.m_capacity, 0)), m_used(std::exchange(other.m_used, 0)),
+      m_free(std::exchange(other.m_free, 0)), m_size(std::exchange(other.m_size, 0)),
+      m_comp(other.m_comp), m_alloc(std::move(other.m_alloc)) {}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>& compact_set<Key, Compare, Allocator>::operator=( const compact_set& other )
+{
+    if (this == &other) return *this;
+
+    destroy_all();
+    m_comp = other.m_comp;
+    if constexpr (node_allocator_traits::propagate_on_container_copy_assignment::value) m_alloc = other.m_alloc;
+    assign_sorted(other.begin(), other.size());
+    return *this;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>& compact_set<Key, Compare, Allocator>::operator=( compact_set&& other ) noexcept
+{
+    if (this == &other) return *this;
+
+    destroy_all();
+    swap(other);
+    return *this;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::iterator compact_set<Key, Compare, Allocator>::begin() const
+{
+    iterator it(this);
+    it.push_left(m_root);
+    return it;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void compact_set<Key, Compare, Allocator>::reserve( size_type new_cap )
+{
+    if (new_cap > max_size()) throw std::length_error("compact_set::reserve");
+    if (new_cap + 1 <= m_capacity) return;
+
+    node* fresh = allocate_arena(new_cap + 1);
+    try
+    {
+        relocate(fresh, new_cap + 1);
+    }
+    catch (...)
+    {
+        node_allocator_traits::deallocate(m_alloc, fresh, new_cap + 1);
+        throw;
+    }
+}
+
+template< class Key, class Compare, class Allocator >
+inline void compact_set<Key, Compare, Allocator>::shrink_to_fit()
+{
+    if (m_nodes == nullptr) return;
+    if (m_size == 0)
+    {
+        destroy_all();
+        return;
+    }
+
+    compact_set renumbered(m_comp, get_allocator());
+    renumbered.assign_sorted(begin(), m_size);
+    swap(renumbered);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void compact_set<Key, Compare, Allocator>::clear() noexcept
+{
+    if (m_nodes == nullptr) return;
+
+    if constexpr (!std::is_trivially_destructible_v<Key>)
+    {
+        auto destroy = [this]( index_type index ) { node_allocator_traits::destroy(m_alloc, &m_nodes[index].key); };
+        for_each_node(m_root, destroy);
+    }
+
+    // every slot is free again, the untouched tail is handed out by m_used
+    m_root = 0;
+    m_used = 1;
+    m_free = 0;
+    m_size = 0;
+}
+
+template< class Key, class Compare, class Allocator >
+template< class... Args >
+inline std::pair<typename compact_set<Key, Compare, Allocator>::iterator, bool> compact_set<Key, Compare, Allocator>::emplace( Args&&... args )
+{
+    // the key only exists once its slot is built, a duplicate slot is released
+    index_type fresh = acquire_slot(std::forward<Args>(args)...);
+    index_type found = 0;
+    try
+    {
+        m_root = insert_at(m_root, fresh, found);
+    }
+    catch (...)
+    {
+        release_slot(fresh);
+        throw;
+    }
+
+    if (found != 0)
+    {
+        release_slot(fresh);
+        return std::make_pair(lower_bound(key_at(found)), false);
+    }
+
+    ++m_size;
+    return std::make_pair(lower_bound(key_at(fresh)), true);
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::iterator compact_set<Key, Compare, Allocator>::erase( const_iterator pos )
+{
+    index_type target = pos.current();
+    if (target == 0) return end();
+
+    // slots never move, so the successor is found again by its key
+    iterator after = pos;
+    ++after;
+    index_type successor = after.current();
+
+    bool erased = false;
+    m_root = erase_at(m_root, key_at(target), erased);
+    --m_size;
+
+    return successor == 0 ? end() : lower_bound(key_at(successor));
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::size_type compact_set<Key, Compare, Allocator>::erase( const key_type& key )
+{
+    bool erased = false;
+    m_root = erase_at(m_root, key, erased);
+    if (!erased) return 0;
+
+    --m_size;
+    return 1;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void compact_set<Key, Compare, Allocator>::swap( compact_set& other ) noexcept
+{
+    std::swap(m_nodes, other.m_nodes);
+    std::swap(m_root, other.m_root);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_used, other.m_used);
+    std::swap(m_free, other.m_free);
+    std::swap(m_size, other.m_size);
+    std::swap(m_comp, other.m_comp);
+    std::swap(m_alloc, other.m_alloc);
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::iterator compact_set<Key, Compare, Allocator>::find( const key_type& key ) const
+{
+    iterator it = lower_bound(key);
+    if (it.current() == 0 || m_comp(key, *it)) return end();
+    return it;
+}
+
+template< class Key, class Compare, class Allocator >
+inline bool compact_set<Key, Compare, Allocator>::contains( const key_type& key ) const
+{
+    index_type index = m_root;
+    while (index != 0)
+    {
+        if (m_comp(key, key_at(index))) index = left(index);
+        else if (m_comp(key_at(index), key)) index = right(index);
+        else return true;
+    }
+    return false;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::iterator compact_set<Key, Compare, Allocator>::lower_bound( const key_type& key ) const
+{
+    // keep only the nodes the walk turned left at, they are the ones still ahead
+    iterator it(this);
+    index_type index = m_root;
+    while (index != 0)
+    {
+        if (m_comp(key_at(index), key)) index = right(index);
+        else
+        {
+            it.m_path[it.m_depth++] = index;
+            index = left(index);
+        }
+    }
+    return it;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::iterator compact_set<Key, Compare, Allocator>::upper_bound( const key_type& key ) const
+{
+    iterator it(this);
+    index_type index = m_root;
+    while (index != 0)
+    {
+        if (!m_comp(key, key_at(index))) index = right(index);
+        else
+        {
+            it.m_path[it.m_depth++] = index;
+            index = left(index);
+        }
+    }
+    return it;
+}
+
+template< class Key, class Compare, class Allocator >
+template< class Fn >
+inline void compact_set<Key, Compare, Allocator>::for_each_in_range( const key_type& lo, const key_type& hi, Fn fn ) const
+{
+    for (iterator it = lower_bound(lo); it.current() != 0 && m_comp(*it, hi); ++it) fn(*it);
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::rotate_left( index_type index )
+{
+    index_type pivot = right(index);
+    m_nodes[index].right = left(pivot);
+    set_left(pivot, index);
+
+    fix_height(index);
+    fix_height(pivot);
+    return pivot;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::rotate_right( index_type index )
+{
+    index_type pivot = left(index);
+    set_left(index, right(pivot));
+    m_nodes[pivot].right = index;
+
+    fix_height(index);
+    fix_height(pivot);
+    return pivot;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::balance( index_type index )
+{
+    // the same cases as set::balance_tree
+    int diff = height(left(index)) - height(right(index));
+    if (diff > 1)
+    {
+        if (height(left(left(index))) < height(right(left(index)))) set_left(index, rotate_left(left(index)));
+        return rotate_right(index);
+    }
+    if (diff < -1)
+    {
+        if (height(right(right(index))) < height(left(right(index)))) m_nodes[index].right = rotate_right(right(index));
+        return rotate_left(index);
+    }
+
+    fix_height(index);
+    return index;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::insert_at( index_type index, index_type fresh, index_type& found )
+{
+    if (index == 0) return fresh;
+
+    if (m_comp(key_at(fresh), key_at(index)))
+    {
+        index_type child = insert_at(left(index), fresh, found);
+        if (found != 0) return index;
+        set_left(index, child);
+    }
+    else if (m_comp(key_at(index), key_at(fresh)))
+    {
+        index_type child = insert_at(right(index), fresh, found);
+        if (found != 0) return index;
+        m_nodes[index].right = child;
+    }
+    else
+    {
+        found = index;
+        return index;
+    }
+    return balance(index);
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::erase_at( index_type index, const key_type& key, bool& erased )
+{
+    if (index == 0) return 0;
+
+    if (m_comp(key, key_at(index)))
+    {
+        index_type child = erase_at(left(index), key, erased);
+        if (!erased) return index;
+        set_left(index, child);
+    }
+    else if (m_comp(key_at(index), key))
+    {
+        index_type child = erase_at(right(index), key, erased);
+        if (!erased) return index;
+        m_nodes[index].right = child;
+    }
+    else
+    {
+        // relink the successor into the erased slot's place, keys never move
+        erased = true;
+        index_type l = left(index);
+        index_type r = right(index);
+        release_slot(index);
+        if (r == 0) return l;
+
+        index_type min;
+        r = remove_min(r, min);
+        set_left(min, l);
+        m_nodes[min].right = r;
+        index = min;
+    }
+    return balance(index);
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::remove_min( index_type index, index_type& min )
+{
+    if (left(index) == 0)
+    {
+        min = index;
+        return right(index);
+    }
+
+    set_left(index, remove_min(left(index), min));
+    return balance(index);
+}
+
+template< class Key, class Compare, class Allocator >
+template< class ForwardIt >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::build_sorted( ForwardIt& it, size_type count )
+{
+    // slots are taken in key order, so in-order walks run through the arena
+    if (count == 0) return 0;
+
+    size_type left_count = count / 2;
+    index_type l = build_sorted(it, left_count);
+
+    index_type index = m_used;
+    node_allocator_traits::construct(m_alloc, m_nodes + index);
+    try
+    {
+        node_allocator_traits::construct(m_alloc, &m_nodes[index].key, *it);
+    }
+    catch (...)
+    {
+        node_allocator_traits::destroy(m_alloc, m_nodes + index);
+        auto destroy = [this]( index_type i ) { node_allocator_traits::destroy(m_alloc, &m_nodes[i].key); };
+        for_each_node(l, destroy);
+        throw;
+    }
+    ++m_used;
+    ++it;
+
+    index_type r;
+    try
+    {
+        r = build_sorted(it, count - left_count - 1);
+    }
+    catch (...)
+    {
+        auto destroy = [this]( index_type i ) { node_allocator_traits::destroy(m_alloc, &m_nodes[i].key); };
+        for_each_node(l, destroy);
+        destroy(index);
+        throw;
+    }
+
+    set_left(index, l);
+    m_nodes[index].right = r;
+    fix_height(index);
+    return index;
+}
+
+template< class Key, class Compare, class Allocator >
+template< class ForwardIt >
+inline void compact_set<Key, Compare, Allocator>::assign_sorted( ForwardIt first, size_type count )
+{
+    // expects an empty set; a failed key copy leaves it empty
+    if (count == 0) return;
+
+    reserve(count);
+    try
+    {
+        m_root = build_sorted(first, count);
+    }
+    catch (...)
+    {
+        m_used = 1;
+        throw;
+    }
+    m_size = count;
+}
+
+template< class Key, class Compare, class Allocator >
+template< class F >
+inline void compact_set<Key, Compare, Allocator>::for_each_node( index_type index, F& f ) const
+{
+    if (index == 0) return;
+
+    index_type r = right(index);
+    for_each_node(left(index), f);
+    f(index);
+    for_each_node(r, f);
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::node* compact_set<Key, Compare, Allocator>::allocate_arena( size_type capacity )
+{
+    node* fresh = node_allocator_traits::allocate(m_alloc, capacity);
+    node_allocator_traits::construct(m_alloc, fresh);
+    return fresh;
+}
+
+template< class Key, class Compare, class Allocator >
+inline compact_set<Key, Compare, Allocator>::size_type compact_set<Key, Compare, Allocator>::grown_capacity() const
+{
+    if (m_size >= max_size()) throw std::length_error("compact_set: index space exhausted");
+
+    size_type grown = m_capacity < 8 ? 8 : size_type(m_capacity) * 2;
+    return std::min<size_type>(grown, max_size() + 1);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void compact_set<Key, Compare, Allocator>::relocate( node* fresh, size_type new_capacity )
+{
+    // every slot keeps its index, only the live keys move
+    if (m_nodes != nullptr)
+    {
+        for (index_type i = 1; i < m_used; ++i)
+        {
+            node_allocator_traits::construct(m_alloc, fresh + i);
+            fresh[i].left_height = m_nodes[i].left_height;
+            fresh[i].right = m_nodes[i].right;
+        }
+
+        // keys are copied unless their move cannot throw, so a throwing copy
+        // leaves the old arena untouched; the caller still owns fresh
+        size_type built = 0;
+        auto move = [this, fresh, &built]( index_type i ) {
+            node_allocator_traits::construct(m_alloc, &fresh[i].key, std::move_if_noexcept(m_nodes[i].key));
+            ++built;
+        };
+        try
+        {
+            for_each_node(m_root, move);
+        }
+        catch (...)
+        {
+            auto unbuild = [this, fresh, &built]( index_type i ) {
+                if (built == 0) return;
+                node_allocator_traits::destroy(m_alloc, &fresh[i].key);
+                --built;
+            };
+            for_each_node(m_root, unbuild);
+            for (index_type i = 1; i < m_used; ++i) node_allocator_traits::destroy(m_alloc, fresh + i);
+            throw;
+        }
+
+        auto destroy = [this]( index_type i ) { node_allocator_traits::destroy(m_alloc, &m_nodes[i].key); };
+        for_each_node(m_root, destroy);
+
+        for (index_type i = 0; i < m_used; ++i) node_allocator_traits::destroy(m_alloc, m_nodes + i);
+        node_allocator_traits::deallocate(m_alloc, m_nodes, m_capacity);
+    }
+    else m_used = 1;
+
+    m_nodes = fresh;
+    m_capacity = static_cast<index_type>(new_capacity);
+}
+
+template< class Key, class Compare, class Allocator >
+template< class... Args >
+inline compact_set<Key, Compare, Allocator>::index_type compact_set<Key, Compare, Allocator>::acquire_slot( Args&&... args )
+{
+    index_type index;
+
+    if (m_free != 0)
+    {
+        index = m_free;
+        node_allocator_traits::construct(m_alloc, &m_nodes[index].key, std::forward<Args>(args)...);
+        m_free = m_nodes[index].right;
+    }
+    else if (m_nodes != nullptr && m_used < m_capacity)
+    {
+        index = m_used;
+        node_allocator_traits::construct(m_alloc, m_nodes + index);
+        node_allocator_traits::construct(m_alloc, &m_nodes[index].key, std::forward<Args>(args)...);
+        ++m_used;
+    }
+    else
+    {
+        // build the key before the move, args may refer into the old arena
+        size_type new_capacity = grown_capacity();
+        node* fresh = allocate_arena(new_capacity);
+        index = m_nodes == nullptr ? 1 : m_used;
+
+        try
+        {
+            node_allocator_traits::construct(m_alloc, fresh + index);
+            node_allocator_traits::construct(m_alloc, &fresh[index].key, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            node_allocator_traits::deallocate(m_alloc, fresh, new_capacity);
+            throw;
+        }
+
+        try
+        {
+            relocate(fresh, new_capacity);
+        }
+        catch (...)
+        {
+            node_allocator_traits::destroy(m_alloc, &fresh[index].key);
+            node_allocator_traits::deallocate(m_alloc, fresh, new_capacity);
+            throw;
+        }
+        ++m_used;
+    }
+
+    // a leaf: no children, height 1
+    m_nodes[index].left_height = index_type(1) << index_bits;
+    m_nodes[index].right = 0;
+    return index;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void compact_set<Key, Compare, Allocator>::release_slot( index_type index ) noexcept
+{
+    node_allocator_traits::destroy(m_alloc, &m_nodes[index].key);
+    m_nodes[index].right = m_free;
+    m_free = index;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void compact_set<Key, Compare, Allocator>::destroy_all() noexcept
+{
+    if (m_nodes == nullptr) return;
+
+    if constexpr (!std::is_trivially_destructible_v<Key>)
+    {
+        auto destroy = [this]( index_type index ) { node_allocator_traits::destroy(m_alloc, &m_nodes[index].key); };
+        for_each_node(m_root, destroy);
+    }
+
+    for (index_type i = 0; i < m_used; ++i) node_allocator_traits::destroy(m_alloc, m_nodes + i);
+    node_allocator_traits::deallocate(m_alloc, m_nodes, m_capacity);
+
+    m_nodes = nullptr;
+    m_root = 0;
+    m_capacity = 0;
+    m_used = 0;
+    m_free = 0;
+    m_size = 0;
+}
+
+#endif // !_COMPACT_SET_HPP_
@@ -0,0 +1,396 @@
+#ifndef _CONCURRENT_QUEUE_HPP_
+#define _CONCURRENT_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#include "../memory/epoch_domain.hpp"
+
+
+// Unbounded lock-free multi-producer multi-consumer queue (Michael-Scott).
+// Nodes are linked like list's nodes, a base_node carrying the link and a node
+// carrying the value, with head always pointing at a dummy node. Popped dummies
+// are retired through an epoch_domain and, once no thread can still read them,
+// pushed onto a lock-free pool that push_back takes nodes from, so the steady
+// state does not touch the allocator. Single-producer or single-consumer use is
+// just a special case.
+template< class T, class Allocator = std::allocator<T> >
+class mpmc_queue
+{
+private:
+    struct base_node;
+    struct node;
+
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = size_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+public:
+    explicit mpmc_queue( const Allocator& alloc = Allocator() );
+    mpmc_queue( const mpmc_queue& ) = delete;
+    mpmc_queue& operator=( const mpmc_queue& ) = delete;
+    ~mpmc_queue();
+
+    void push_back( const T& value ) { emplace_back(value); }
+    void push_back( T&& value ) { emplace_back(std::move(value)); }
+
+    template< class... Args >
+    void emplace_back( Args&&... args );
+
+    bool try_pop_front( T& out );
+
+    // snapshot, may be stale by the time it returns
+    bool empty() const noexcept;
+
+private:
+    struct base_node
+    {
+        std::atomic<base_node*> next{ nullptr };
+    };
+
+    struct node : base_node
+    {
+        union { T value; };
+
+        node() {}
+        ~node() {}
+    };
+
+    node* acquire_node();
+    static void recycle( void* object, void* context );
+    void free_pool();
+
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<node>;
+
+    alignas(64) std::atomic<base_node*> m_head;
+    alignas(64) std::atomic<base_node*> m_tail;
+    alignas(64) std::atomic<base_node*> m_pool{ nullptr };
+    node_allocator m_alloc;
+    epoch_domain m_domain;
+};
+
+template< class T, class Allocator >
+inline mpmc_queue<T, Allocator>::mpmc_queue( const Allocator& alloc ) : m_alloc(alloc)
+{
+    node* dummy = node_allocator_traits::allocate(m_alloc, 1);
+    node_allocator_traits::construct(m_alloc, dummy);
+
+    m_head.store(dummy, std::memory_order_relaxed);
+    m_tail.store(dummy, std::memory_order_relaxed);
+}
+
+template< class T, class Allocator >
+inline mpmc_queue<T, Allocator>::~mpmc_queue()
+{
+    // retired dummies go back to the pool first, then everything is freed
+    m_domain.reclaim_all();
+    free_pool();
+
+    base_node* current = m_head.load(std::memory_order_relaxed);
+    bool dummy = true;
+    while (current != nullptr)
+    {
+        node* queued = static_cast<node*>(current);
+        current = current->next.load(std::memory_order_relaxed);
+
+        if (!dummy) queued->value.~T();
+        dummy = false;
+
+        node_allocator_traits::destroy(m_alloc, queued);
+        node_allocator_traits::deallocate(m_alloc, queued, 1);
+    }
+}
+
+template< class T, class Allocator >
+inline mpmc_queue<T, Allocator>::node* mpmc_queue<T, Allocator>::acquire_node()
+{
+    // callers are pinned, so a pooled node cannot be recycled under our feet (no ABA)
+    base_node* top = m_pool.load(std::memory_order_acquire);
+    while (top != nullptr)
+    {
+        base_node* next = top->next.load(std::memory_order_relaxed);
+        if (m_pool.compare_exchange_weak(top, next, std::memory_order_acquire, std::memory_order_acquire))
+        {
+            top->next.store(nullptr, std::memory_order_relaxed);
+            return static_cast<node*>(top);
+        }
+    }
+
+    node* fresh = node_allocator_traits::allocate(m_alloc, 1);
+    node_allocator_traits::construct(m_alloc, fresh);
+    return fresh;
+}
+
+template< class T, class Allocator >
+inline void mpmc_queue<T, Allocator>::recycle( void* object, void* context )
+{
+    auto* self = static_cast<mpmc_queue*>(context);
+    auto* freed = static_cast<base_node*>(static_cast<node*>(object));
+
+    base_node* top = self->m_pool.load(std::memory_order_relaxed);
+    do freed->next.store(top, std::memory_order_relaxed);
+    while (!self->m_pool.compare_exchange_weak(top, freed, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template< class T, class Allocator >
+inline void mpmc_queue<T, Allocator>::free_pool()
+{
+    base_node* current = m_pool.exchange(nullptr, std::memory_order_acquire);
+    while (current != nullptr)
+    {
+        node* pooled = static_cast<node*>(current);
+        current = current->next.load(std::memory_order_relaxed);
+
+        node_allocator_traits::destroy(m_alloc, pooled);
+        node_allocator_traits::deallocate(m_alloc, pooled, 1);
+    }
+}
+
+template< class T, class Allocator >
+template< class... Args >
+inline void mpmc_queue<T, Allocator>::emplace_back( Args&&... args )
+{
+    auto guard = m_domain.pin();
+
+    node* fresh = acquire_node();
+    try
+    {
+        ::new (static_cast<void*>(std::addressof(fresh->value))) T(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        // a thread pinned before us may still hold fresh as the pool top, so it
+        // goes back through the epoch like a popped dummy
+        guard.retire(fresh, &mpmc_queue::recycle, this);
+        throw;
+    }
+
+    while (true)
+    {
+        base_node* tail = m_tail.load(std::memory_order_acquire);
+        base_node* next = tail->next.load(std::memory_order_acquire);
+
+        if (tail != m_tail.load(std::memory_order_acquire)) continue;
+
+        if (next == nullptr)
+        {
+            if (tail->next.compare_exchange_weak(next, fresh, std::memory_order_release, std::memory_order_relaxed))
+            {
+                m_tail.compare_exchange_strong(tail, fresh, std::memory_order_release, std::memory_order_relaxed);
+                return;
+            }
+        }
+        // tail is lagging behind, help the other producer
+        else m_tail.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+    }
+}
+
+template< class T, class Allocator >
+inline bool mpmc_queue<T, Allocator>::try_pop_front( T& out )
+{
+    auto guard = m_domain.pin();
+
+    while (true)
+    {
+        base_node* head = m_head.load(std::memory_order_acquire);
+        base_node* tail = m_tail.load(std::memory_order_acquire);
+        base_node* next = head->next.load(std::memory_order_acquire);
+
+        if (head != m_head.load(std::memory_order_acquire)) continue;
+
+        if (next == nullptr) return false;
+
+        if (head == tail)
+        {
+            m_tail.compare_exchange_weak(tail, next, std::memory_order_release, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (m_head.compare_exchange_weak(head, next, std::memory_order_acq_rel, std::memory_order_relaxed))
+        {
+            // next is the new dummy, its value belongs to us alone
+            T& value = static_cast<node*>(next)->value;
+            out = std::move(value);
+            value.~T();
+
+            guard.retire(static_cast<node*>(head), &mpmc_queue::recycle, this);
+            return true;
+        }
+    }
+}
+
+template< class T, class Allocator >
+inline bool mpmc_queue<T, Allocator>::empty() const noexcept
+{
+    base_node* head = m_head.load(std::memory_order_acquire);
+    return head->next.load(std::memory_order_acquire) == nullptr;
+}
+
+
+// Bounded lock-free multi-producer multi-consumer queue over a ring of cells.
+// Every cell carries a sequence number that tells producers and consumers
+// whether it is free for the lap they are on (Vyukov). No node is ever freed,
+// so no reclamation is needed; capacity is rounded up to a power of two.
+template< class T, class Allocator = std::allocator<T> >
+class bounded_mpmc_queue
+{
+public:
+    using value_type = T;
+    using allocator_type = Allocator;
+    using size_type = size_t;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+public:
+    explicit bounded_mpmc_queue( size_type capacity, const Allocator& alloc = Allocator() );
+    bounded_mpmc_queue( const bounded_mpmc_queue& ) = delete;
+    bounded_mpmc_queue& operator=( const bounded_mpmc_queue& ) = delete;
+    ~bounded_mpmc_queue();
+
+    size_type capacity() const noexcept { return m_mask + 1; }
+
+    bool try_push_back( const T& value ) { return try_emplace_back(value); }
+    bool try_push_back( T&& value ) { return try_emplace_back(std::move(value)); }
+
+    template< class... Args >
+    bool try_emplace_back( Args&&... args );
+
+    bool try_pop_front( T& out );
+
+private:
+    struct cell
+    {
+        std::atomic<size_type> sequence;
+        // published without a value because its constructor threw, consumers step over it
+        bool skipped = false;
+        union { T value; };
+
+        cell( size_type seq ) : sequence(seq) {}
+        ~cell() {}
+    };
+
+    using cell_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<cell>;
+    using cell_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<cell>;
+
+    cell_allocator m_alloc;
+    cell* m_cells;
+    size_type m_mask;
+
+    alignas(64) std::atomic<size_type> m_enqueue_pos{ 0 };
+    alignas(64) std::atomic<size_type> m_dequeue_pos{ 0 };
+};
+
+template< class T, class Allocator >
+inline bounded_mpmc_queue<T, Allocator>::bounded_mpmc_queue( size_type capacity, const Allocator& alloc ) : m_alloc(alloc)
+{
+    if (capacity == 0) throw std::invalid_argument("bounded_mpmc_queue: capacity must be positive");
+
+    size_type rounded = 1;
+    while (rounded < capacity) rounded <<= 1;
+
+    m_mask = rounded - 1;
+    m_cells = cell_allocator_traits::allocate(m_alloc, rounded);
+    for (size_type i = 0; i < rounded; ++i) cell_allocator_traits::construct(m_alloc, m_cells + i, i);
+}
+
+template< class T, class Allocator >
+inline bounded_mpmc_queue<T, Allocator>::~bounded_mpmc_queue()
+{
+    size_type first = m_dequeue_pos.load(std::memory_order_relaxed);
+    size_type last = m_enqueue_pos.load(std::memory_order_relaxed);
+    for (; first != last; ++first)
+        if (!m_cells[first & m_mask].skipped) m_cells[first & m_mask].value.~T();
+
+    for (size_type i = 0; i <= m_mask; ++i) cell_allocator_traits::destroy(m_alloc, m_cells + i);
+    cell_allocator_traits::deallocate(m_alloc, m_cells, m_mask + 1);
+}
+
+template< class T, class Allocator >
+template< class... Args >
+inline bool bounded_mpmc_queue<T, Allocator>::try_emplace_back( Args&&... args )
+{
+    size_type pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    cell* target;
+
+    while (true)
+    {
+        target = &m_cells[pos & m_mask];
+        size_type seq = target->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+        if (diff == 0)
+        {
+            if (m_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        }
+        else if (diff < 0) return false;
+        else pos = m_enqueue_pos.load(std::memory_order_relaxed);
+    }
+
+    // pos is claimed, so the cell is published even if the value cannot be built
+    try
+    {
+        ::new (static_cast<void*>(std::addressof(target->value))) T(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        target->skipped = true;
+        target->sequence.store(pos + 1, std::memory_order_release);
+        throw;
+    }
+    target->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template< class T, class Allocator >
+inline bool bounded_mpmc_queue<T, Allocator>::try_pop_front( T& out )
+{
+    size_type pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    cell* target;
+
+    while (true)
+    {
+        target = &m_cells[pos & m_mask];
+        size_type seq = target->sequence.load(std::memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+
+        if (diff == 0)
+        {
+            if (m_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+            {
+                if (!target->skipped) break;
+
+                // free the cell for the next lap and try the one after it
+                target->skipped = false;
+                target->sequence.store(pos + m_mask + 1, std::memory_order_release);
+                pos = m_dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+        else if (diff < 0) return false;
+        else pos = m_dequeue_pos.load(std::memory_order_relaxed);
+    }
+
+    // the cell is freed even if the assignment throws, the value is lost but the queue keeps going
+    try
+    {
+        out = std::move(target->value);
+    }
+    catch (...)
+    {
+        target->value.~T();
+        target->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        throw;
+    }
+    target->value.~T();
+    target->sequence.store(pos + m_mask + 1, std::memory_order_release);
+    return true;
+}
+
+#endif // !_CONCURRENT_QUEUE_HPP_
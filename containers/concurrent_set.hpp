@@ -0,0 +1,520 @@
+#ifndef _CONCURRENT_SET_HPP_
+#define _CONCURRENT_SET_HPP_
+
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#include "../memory/epoch_domain.hpp"
+
+
+// Ordered set for many concurrent readers and writers: a lazy skip list
+// (Herlihy, Lev, Luchangco, Shavit). Lookups and iteration take no locks and
+// never write shared memory. insert and erase search without locks, then lock
+// only the predecessors they relink, validate them and retry on conflict. Every
+// node carries its own tower of links, a marked flag set when erase logically
+// removes it and a fully_linked flag set when insert has linked every level;
+// a key is in the set while its node is fully linked and not marked.
+//
+// Unlinked nodes are retired through an epoch_domain, so a reader that still
+// sees one can keep walking it. Iterators pin the domain for as long as they
+// are not end() and are weakly consistent: they yield keys in ascending order,
+// each at most once, and see every key that stays in the set throughout.
+//
+// Iterators are move-only input iterators and end() is std::default_sentinel.
+// Each iterator short of end() holds one of the domain's max_slots pins and
+// holds back reclamation while it lives, so a thread must not keep that many
+// unfinished at once (it would wait on itself in pin). Long or many traversals
+// belong in for_each_in_range, which pins once per call.
+template< class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key> >
+class concurrent_set
+{
+private:
+    struct node;
+
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using size_type = size_t;
+    using reference = const value_type&;
+    using const_reference = const value_type&;
+
+    static constexpr int max_height = 32;
+
+    class const_iterator
+    {
+    private:
+        friend class concurrent_set;
+
+        const_iterator() : m_node(nullptr) {}
+        const_iterator( epoch_domain::guard&& guard, node* first ) : m_guard(std::move(guard)), m_node(first)
+        {
+            if (m_node == nullptr) m_guard.reset();
+        }
+
+        std::optional<epoch_domain::guard> m_guard;
+        node* m_node;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Key*;
+        using reference = const Key&;
+
+        const_iterator( const_iterator&& other ) noexcept = default;
+        const_iterator& operator=( const_iterator&& other ) noexcept = default;
+
+        reference operator*() const { return m_node->key; }
+        pointer operator->() const { return &m_node->key; }
+
+        const_iterator& operator++()
+        {
+            m_node = live_from(m_node->next(0).load(std::memory_order_acquire));
+            if (m_node == nullptr) m_guard.reset();
+            return *this;
+        }
+        void operator++( int ) { ++*this; }
+
+        bool operator==( const const_iterator& other ) const { return m_node == other.m_node; }
+        bool operator!=( const const_iterator& other ) const { return m_node != other.m_node; }
+        bool operator==( std::default_sentinel_t ) const { return m_node == nullptr; }
+    };
+
+    using iterator = const_iterator;
+
+public:
+    explicit concurrent_set( const Compare& comp = Compare(), const Allocator& alloc = Allocator() );
+    concurrent_set( const concurrent_set& ) = delete;
+    concurrent_set& operator=( const concurrent_set& ) = delete;
+    ~concurrent_set();
+
+    bool insert( const value_type& key );
+    bool insert( value_type&& key );
+
+    template< class... Args >
+    bool emplace( Args&&... args );
+
+    size_type erase( const key_type& key );
+
+    // the key, pinned like any iterator, or end()
+    const_iterator find( const key_type& key ) const;
+    bool contains( const key_type& key ) const;
+
+    // the first key not less than key, pinned until it reaches end()
+    const_iterator lower_bound( const key_type& key ) const;
+
+    const_iterator begin() const;
+    // iterators are move-only, ranges need a copyable end
+    std::default_sentinel_t end() const noexcept { return std::default_sentinel; }
+
+    // calls fn on every key in [lo, hi) under a single pin
+    template< class F >
+    void for_each_in_range( const key_type& lo, const key_type& hi, F&& fn ) const;
+
+    // snapshots, may be stale by the time they return
+    size_type size() const noexcept { return m_size.load(std::memory_order_relaxed); }
+    bool empty() const noexcept { return size() == 0; }
+
+private:
+    using link = std::atomic<node*>;
+
+    struct alignas(link) node
+    {
+        union { Key key; };
+        std::atomic<bool> marked{ false };
+        std::atomic<bool> fully_linked{ false };
+        std::atomic<bool> locked{ false };
+        int height;
+
+        node( int h ) : height(h) {}
+        ~node() {}
+
+        // the tower is allocated right behind the node
+        link& next( int level ) { return reinterpret_cast<link*>(this + 1)[level]; }
+
+        void lock()
+        {
+            for (unsigned spins = 0; locked.exchange(true, std::memory_order_acquire); ++spins)
+                if (spins >= 64) std::this_thread::yield();
+        }
+
+        void unlock() { locked.store(false, std::memory_order_release); }
+    };
+
+    static size_type node_units( int height ) { return 1 + (height * sizeof(link) + sizeof(node) - 1) / sizeof(node); }
+
+    node* allocate_node( int height );
+    void deallocate_node( node* n );
+
+    template< class... Args >
+    node* create_node( int height, Args&&... args );
+    void destroy_node( node* n );
+    static void reclaim( void* object, void* context );
+
+    static int random_height();
+    void raise_height( int height );
+
+    // fills preds and succs on every level below m_height and returns the
+    // highest level the key was found on, or -1
+    int find_position( const key_type& key, node** preds, node** succs ) const;
+
+    // the first node at or after n that is in the set
+    static node* live_from( node* n );
+
+    static void unlock_preds( node** preds, int highest );
+
+    bool insert_node( node* fresh );
+
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<node>;
+
+    node* m_head;
+    alignas(64) std::atomic<int> m_height{ 1 };
+    alignas(64) std::atomic<size_type> m_size{ 0 };
+    Compare m_comp;
+    node_allocator m_alloc;
+    mutable epoch_domain m_domain;
+};
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::concurrent_set( const Compare& comp, const Allocator& alloc ) : m_comp(comp), m_alloc(alloc)
+{
+    m_head = allocate_node(max_height);
+}
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::~concurrent_set()
+{
+    // retired nodes are unlinked already, free them before what is still in the list
+    m_domain.reclaim_all();
+
+    node* current = m_head->next(0).load(std::memory_order_relaxed);
+    while (current != nullptr)
+    {
+        node* next = current->next(0).load(std::memory_order_relaxed);
+        destroy_node(current);
+        current = next;
+    }
+    deallocate_node(m_head);
+}
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::node* concurrent_set<Key, Compare, Allocator>::allocate_node( int height )
+{
+    node* n = node_allocator_traits::allocate(m_alloc, node_units(height));
+    ::new (static_cast<void*>(n)) node(height);
+    for (int level = 0; level < height; ++level) ::new (static_cast<void*>(&n->next(level))) link(nullptr);
+    return n;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void concurrent_set<Key, Compare, Allocator>::deallocate_node( node* n )
+{
+    size_type units = node_units(n->height);
+    n->~node();
+    node_allocator_traits::deallocate(m_alloc, n, units);
+}
+
+template< class Key, class Compare, class Allocator >
+template< class... Args >
+inline concurrent_set<Key, Compare, Allocator>::node* concurrent_set<Key, Compare, Allocator>::create_node( int height, Args&&... args )
+{
+    node* n = allocate_node(height);
+    try
+    {
+        ::new (static_cast<void*>(std::addressof(n->key))) Key(std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        deallocate_node(n);
+        throw;
+    }
+    return n;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void concurrent_set<Key, Compare, Allocator>::destroy_node( node* n )
+{
+    n->key.~Key();
+    deallocate_node(n);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void concurrent_set<Key, Compare, Allocator>::reclaim( void* object, void* context )
+{
+    static_cast<concurrent_set*>(context)->destroy_node(static_cast<node*>(object));
+}
+
+template< class Key, class Compare, class Allocator >
+inline int concurrent_set<Key, Compare, Allocator>::random_height()
+{
+    // xorshift per thread, each level kept with probability 1/2
+    thread_local std::uint64_t state = std::hash<std::thread::id>()(std::this_thread::get_id()) | 1;
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+
+    return 1 + std::countr_zero(static_cast<std::uint32_t>(state >> 32) | (1u << (max_height - 1)));
+}
+
+template< class Key, class Compare, class Allocator >
+inline void concurrent_set<Key, Compare, Allocator>::raise_height( int height )
+{
+    int current = m_height.load(std::memory_order_relaxed);
+    while (current < height && !m_height.compare_exchange_weak(current, height, std::memory_order_acq_rel));
+}
+
+template< class Key, class Compare, class Allocator >
+inline int concurrent_set<Key, Compare, Allocator>::find_position( const key_type& key, node** preds, node** succs ) const
+{
+    int found = -1;
+    node* pred = m_head;
+    for (int level = m_height.load(std::memory_order_acquire) - 1; level >= 0; --level)
+    {
+        node* curr = pred->next(level).load(std::memory_order_acquire);
+        while (curr != nullptr && m_comp(curr->key, key))
+        {
+            pred = curr;
+            curr = pred->next(level).load(std::memory_order_acquire);
+        }
+
+        if (found == -1 && curr != nullptr && !m_comp(key, curr->key)) found = level;
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+    return found;
+}
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::node* concurrent_set<Key, Compare, Allocator>::live_from( node* n )
+{
+    while (n != nullptr && (n->marked.load(std::memory_order_acquire) || !n->fully_linked.load(std::memory_order_acquire)))
+        n = n->next(0).load(std::memory_order_acquire);
+    return n;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void concurrent_set<Key, Compare, Allocator>::unlock_preds( node** preds, int highest )
+{
+    // a node can be the predecessor on several consecutive levels, it is locked once
+    for (int level = 0; level <= highest; ++level)
+        if (level == 0 || preds[level] != preds[level - 1]) preds[level]->unlock();
+}
+
+template< class Key, class Compare, class Allocator >
+inline bool concurrent_set<Key, Compare, Allocator>::insert_node( node* fresh )
+{
+    int height = fresh->height;
+    raise_height(height);
+
+    node* preds[max_height];
+    node* succs[max_height];
+    while (true)
+    {
+        int found = find_position(fresh->key, preds, succs);
+        if (found != -1)
+        {
+            node* hit = succs[found];
+            // a marked twin is on its way out, retry once it is unlinked
+            if (hit->marked.load(std::memory_order_acquire)) continue;
+
+            while (!hit->fully_linked.load(std::memory_order_acquire)) std::this_thread::yield();
+            return false;
+        }
+
+        int highest = -1;
+        bool valid = true;
+        for (int level = 0; valid && level < height; ++level)
+        {
+            node* pred = preds[level];
+            node* succ = succs[level];
+            if (level == 0 || pred != preds[level - 1]) pred->lock();
+            highest = level;
+
+            valid = !pred->marked.load(std::memory_order_acquire)
+                && (succ == nullptr || !succ->marked.load(std::memory_order_acquire))
+                && pred->next(level).load(std::memory_order_acquire) == succ;
+        }
+
+        if (!valid)
+        {
+            unlock_preds(preds, highest);
+            continue;
+        }
+
+        for (int level = 0; level < height; ++level) fresh->next(level).store(succs[level], std::memory_order_relaxed);
+        for (int level = 0; level < height; ++level) preds[level]->next(level).store(fresh, std::memory_order_release);
+        fresh->fully_linked.store(true, std::memory_order_release);
+
+        unlock_preds(preds, highest);
+        m_size.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+}
+
+template< class Key, class Compare, class Allocator >
+inline bool concurrent_set<Key, Compare, Allocator>::insert( const value_type& key )
+{
+    // skip building a node when the key is plainly there
+    if (contains(key)) return false;
+    return emplace(key);
+}
+
+template< class Key, class Compare, class Allocator >
+inline bool concurrent_set<Key, Compare, Allocator>::insert( value_type&& key )
+{
+    if (contains(key)) return false;
+    return emplace(std::move(key));
+}
+
+template< class Key, class Compare, class Allocator >
+template< class... Args >
+inline bool concurrent_set<Key, Compare, Allocator>::emplace( Args&&... args )
+{
+    node* fresh = create_node(random_height(), std::forward<Args>(args)...);
+
+    bool inserted;
+    {
+        auto guard = m_domain.pin();
+        inserted = insert_node(fresh);
+    }
+
+    // never published, no reader can hold it
+    if (!inserted) destroy_node(fresh);
+    return inserted;
+}
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::size_type concurrent_set<Key, Compare, Allocator>::erase( const key_type& key )
+{
+    auto guard = m_domain.pin();
+
+    node* preds[max_height];
+    node* succs[max_height];
+    node* victim = nullptr;
+    while (true)
+    {
+        int found = find_position(key, preds, succs);
+        if (victim == nullptr)
+        {
+            if (found == -1) return 0;
+
+            // a node still being linked is not in the set yet
+            node* hit = succs[found];
+            if (!hit->fully_linked.load(std::memory_order_acquire) || hit->height - 1 != found) return 0;
+
+            hit->lock();
+            if (hit->marked.load(std::memory_order_acquire))
+            {
+                hit->unlock();
+                return 0;
+            }
+            hit->marked.store(true, std::memory_order_release);
+            victim = hit;
+        }
+
+        int height = victim->height;
+        int highest = -1;
+        bool valid = true;
+        for (int level = 0; valid && level < height; ++level)
+        {
+            node* pred = preds[level];
+            if (level == 0 || pred != preds[level - 1]) pred->lock();
+            highest = level;
+
+            valid = !pred->marked.load(std::memory_order_acquire) && pred->next(level).load(std::memory_order_acquire) == victim;
+        }
+
+        if (!valid)
+        {
+            unlock_preds(preds, highest);
+            continue;
+        }
+
+        // victim is marked and locked, its own links can no longer change
+        for (int level = height - 1; level >= 0; --level)
+            preds[level]->next(level).store(victim->next(level).load(std::memory_order_relaxed), std::memory_order_release);
+
+        victim->unlock();
+        unlock_preds(preds, highest);
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+
+        guard.retire(victim, &concurrent_set::reclaim, this);
+        return 1;
+    }
+}
+
+template< class Key, class Compare, class Allocator >
+inline bool concurrent_set<Key, Compare, Allocator>::contains( const key_type& key ) const
+{
+    auto guard = m_domain.pin();
+
+    node* preds[max_height];
+    node* succs[max_height];
+    int found = find_position(key, preds, succs);
+    if (found == -1) return false;
+
+    node* hit = succs[found];
+    return hit->fully_linked.load(std::memory_order_acquire) && !hit->marked.load(std::memory_order_acquire);
+}
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::const_iterator concurrent_set<Key, Compare, Allocator>::find( const key_type& key ) const
+{
+    auto guard = m_domain.pin();
+
+    node* preds[max_height];
+    node* succs[max_height];
+    int found = find_position(key, preds, succs);
+    if (found == -1) return const_iterator();
+
+    node* hit = succs[found];
+    if (!hit->fully_linked.load(std::memory_order_acquire) || hit->marked.load(std::memory_order_acquire)) return const_iterator();
+    return const_iterator(std::move(guard), hit);
+}
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::const_iterator concurrent_set<Key, Compare, Allocator>::lower_bound( const key_type& key ) const
+{
+    auto guard = m_domain.pin();
+
+    node* preds[max_height];
+    node* succs[max_height];
+    find_position(key, preds, succs);
+    return const_iterator(std::move(guard), live_from(succs[0]));
+}
+
+template< class Key, class Compare, class Allocator >
+inline concurrent_set<Key, Compare, Allocator>::const_iterator concurrent_set<Key, Compare, Allocator>::begin() const
+{
+    auto guard = m_domain.pin();
+    return const_iterator(std::move(guard), live_from(m_head->next(0).load(std::memory_order_acquire)));
+}
+
+template< class Key, class Compare, class Allocator >
+template< class F >
+inline void concurrent_set<Key, Compare, Allocator>::for_each_in_range( const key_type& lo, const key_type& hi, F&& fn ) const
+{
+    auto guard = m_domain.pin();
+
+    node* preds[max_height];
+    node* succs[max_height];
+    find_position(lo, preds, succs);
+
+    for (node* n = live_from(succs[0]); n != nullptr && m_comp(n->key, hi); n = live_from(n->next(0).load(std::memory_order_acquire)))
+        fn(n->key);
+}
+
+#endif // !_CONCURRENT_SET_HPP_
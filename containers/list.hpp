@@ -93,12 +93,13 @@ public:
 	const_reverse_iterator crend() const noexcept { return const_reverse_iterator(const_cast<base_node*>(fake_node.next)); }
 
 	// capacity
-	bool empty() const noexcept { return size() == 0; }
+	bool empty() const noexcept { return fake_node.next == &fake_node; }
 	size_type size() const noexcept { return std::distance(begin(), end()); }
 	size_type max_size() const noexcept { return node_allocator_traits::max_size(m_alloc); }
 
 	// modifiers
 	void clear();
+	void clear( list& graveyard ) { graveyard.splice(graveyard.end(), *this); }
 
 	iterator insert( const_iterator pos, const T& value ) { return insert_impl(pos, create_node(value)); }
 	iterator insert( const_iterator pos, T&& value ) { return insert_impl(pos, create_node(std::move(value))); }
@@ -155,12 +156,22 @@ public:
 	template< class UnaryPredicate >
 	size_type remove_if( UnaryPredicate p );
 
+	// deferred variants: victims are spliced onto graveyard instead of being
+	// destroyed, the caller frees them later with graveyard.clear() or a list_reclaimer
+	size_type remove( const T& value, list& graveyard );
+	template< class UnaryPredicate >
+	size_type remove_if( UnaryPredicate p, list& graveyard );
+
 	void reverse() noexcept;
 
 	size_type unique();
 	template< class BinaryPredicate >
 	size_type unique( BinaryPredicate p );	
 
+	size_type unique( list& graveyard );
+	template< class BinaryPredicate >
+	size_type unique( BinaryPredicate p, list& graveyard );
+
 	void sort() { sort(std::less<T>()); }
 	template< class Compare >
 	void sort( Compare comp );
@@ -188,6 +199,7 @@ private:
 
 	public:
 		twindiriter(const twindiriter& other) : m_node(other.m_node) { }
+		twindiriter& operator = (const twindiriter& other) = default;
 
 		reference operator * () const noexcept { return static_cast<node*>(m_node)->value; }
 		pointer operator -> () const noexcept { return &static_cast<node*>(m_node)->value; }
@@ -266,6 +278,7 @@ private:
 				m_tail = new_node;
 			}
 		}
+		sync_ends();
 	}
 
 	template< std::input_iterator InputIt >
@@ -295,10 +308,18 @@ private:
 			}
 			
 		}
+		sync_ends();
 	}
 
 	iterator insert_impl(const_iterator pos, node* new_node);
 
+	// m_head/m_tail mirror fake_node.next/prev, refresh them after relinking
+	void sync_ends() noexcept
+	{
+		m_head = static_cast<node*>(fake_node.next);
+		m_tail = static_cast<node*>(fake_node.prev);
+	}
+
 	node* create_node(const T& value)
 	{
 		node* new_node = node_allocator_traits::allocate(m_alloc, 1);
@@ -646,7 +667,7 @@ inline list<T, Allocator>::iterator list<T, Allocator>::erase(const_iterator pos
 		fake_node.next = next;
 		next->prev = &fake_node;
 
-		m_head = static_cast<node*>(next->prev);
+		sync_ends();
 
 		destroy_node(current);
 
@@ -659,6 +680,7 @@ inline list<T, Allocator>::iterator list<T, Allocator>::erase(const_iterator pos
 
 	prev->next = next;
 	next->prev = prev;
+	sync_ends();
 
 	destroy_node(current);
 
@@ -684,6 +706,7 @@ inline list<T, Allocator>::iterator list<T, Allocator>::erase(const_iterator fir
 
 		destroy_node(current);
 	}
+	sync_ends();
 
 	return iterator(last_node);
 }
@@ -716,7 +739,7 @@ inline void list<T, Allocator>::pop_back()
 
 	prev->next = next;
 	next->prev = prev;
-
+	sync_ends();
 }
 
 template <class T, class Allocator>
@@ -730,7 +753,7 @@ inline void list<T, Allocator>::pop_front()
 	fake_node.next = next;
 	next->prev = &fake_node;
 
-	m_head = next;
+	sync_ends();
 
 	destroy_node(current);
 }
@@ -786,13 +809,13 @@ inline void list<T, Allocator>::merge(list& other, Compare comp)
 template< class T, class Allocator >
 inline void list<T, Allocator>::splice(const_iterator pos, list& other)
 {
-	if (other.empty()) return;
+	if (this == &other || other.empty()) return;
 	
 	node* pos_node = static_cast<node*>(pos.m_node);
 	node* prev_pos_node = static_cast<node*>(pos.m_node->prev);
 
-	node* first_node = other.m_head;
-	node* last_node = other.m_tail;
+	node* first_node = static_cast<node*>(other.fake_node.next);
+	node* last_node = static_cast<node*>(other.fake_node.prev);
 
 	pos_node->prev = last_node;
 	last_node->next = pos_node;
@@ -800,51 +823,35 @@ inline void list<T, Allocator>::splice(const_iterator pos, list& other)
 	prev_pos_node->next = first_node;
 	first_node->prev = prev_pos_node;
 
-	other.m_head = static_cast<node*>(&other.fake_node);
-	other.m_tail = static_cast<node*>(&other.fake_node);
-	other.m_head->prev = &other.fake_node;
-	other.m_tail->next = &other.fake_node;
+	other.fake_node.next = &other.fake_node;
+	other.fake_node.prev = &other.fake_node;
+
+	sync_ends();
+	other.sync_ends();
 }
 
 template< class T, class Allocator >
 inline void list<T, Allocator>::splice(const_iterator pos, list& other, const_iterator it)
 {
-	node* pos_node = static_cast<node*>(pos.m_node);
-	node* prev_pos_node = static_cast<node*>(pos.m_node->prev);
+	if (pos.m_node == it.m_node || pos.m_node == it.m_node->next) return;
 
 	node* other_it_node = static_cast<node*>(it.m_node);
 
-	if (it == other.cbegin())
-	{
-		node* next_other_it_node = static_cast<node*>(other.m_head->next);
-		node* prev_other_it_node = static_cast<node*>(&other.fake_node);
-
-		pos_node->prev = other_it_node;
-		other_it_node->next = pos_node;
+	// unlink from other first, pos may be a neighbour of it
+	other_it_node->prev->next = other_it_node->next;
+	other_it_node->next->prev = other_it_node->prev;
 
-		prev_pos_node->next = other_it_node;
-		other_it_node->prev = prev_pos_node;
-
-		next_other_it_node->prev = &other.fake_node;
-		other.fake_node.next = next_other_it_node;
-
-		other.m_head = next_other_it_node;
-	}
-
-	else
-	{
-		node* next_other_it_node = static_cast<node*>(it.m_node->next);
-		node* prev_other_it_node = static_cast<node*>(it.m_node->prev);
+	node* pos_node = static_cast<node*>(pos.m_node);
+	node* prev_pos_node = static_cast<node*>(pos.m_node->prev);
 
-		pos_node->prev = other_it_node;
-		other_it_node->next = pos_node;
+	prev_pos_node->next = other_it_node;
+	other_it_node->prev = prev_pos_node;
 
-		prev_pos_node->next = other_it_node;
-		other_it_node->prev = prev_pos_node;
+	pos_node->prev = other_it_node;
+	other_it_node->next = pos_node;
 
-		next_other_it_node->prev = prev_other_it_node;
-		prev_other_it_node->next = next_other_it_node;
-	}
+	sync_ends();
+	if (this != &other) other.sync_ends();
 }
 
 template< class T, class Allocator >
@@ -896,39 +903,57 @@ inline void list<T, Allocator>::splice(const_iterator pos, list& other, const_it
 		pos_node->prev = prev_last_node;
 	}
 
+	sync_ends();
+	if (this != &other) other.sync_ends();
 }
 
 template< class T, class Allocator >
 inline list<T, Allocator>::size_type list<T, Allocator>::remove(const T& value)
 {
-	size_type counter = 0;
+	list graveyard(m_alloc);
+	return remove(value, graveyard);
+}
 
-	for (auto it = begin(); it != end();)
-	{
-		if (*it == value)
+template< class T, class Allocator >
+template< class UnaryPredicate >
+inline list<T, Allocator>::size_type list<T, Allocator>::remove_if(UnaryPredicate p)
+{
+	list graveyard(m_alloc);
+	return remove_if(p, graveyard);
+}
+
+template< class T, class Allocator >
+inline list<T, Allocator>::size_type list<T, Allocator>::remove(const T& value, list& graveyard)
+{
+	// value may refer to an element of this list, victims stay alive in graveyard
+	return remove_if(
+		[&value](const auto& elem)
 		{
-			it = erase(it);
-			++counter;
-		}
-		else ++it;
-	}
-	return counter;
+			return elem == value;
+		},
+		graveyard
+	);
 }
 
 template< class T, class Allocator >
 template< class UnaryPredicate >
-inline list<T, Allocator>::size_type list<T, Allocator>::remove_if(UnaryPredicate p)
+inline list<T, Allocator>::size_type list<T, Allocator>::remove_if(UnaryPredicate p, list& graveyard)
 {
 	size_type counter = 0;
 
 	for (auto it = begin(); it != end();)
 	{
-		if (p(*it))
+		if (!p(*it))
 		{
-			it = erase(it);
-			++counter;
+			++it;
+			continue;
 		}
-		else ++it;
+
+		// move the whole run of victims with one splice
+		auto run_first = it;
+		for (++it, ++counter; it != end() && p(*it); ++it) ++counter;
+
+		graveyard.splice(graveyard.end(), *this, run_first, it);
 	}
 	return counter;
 }
@@ -970,22 +995,43 @@ inline list<T, Allocator>::size_type list<T, Allocator>::unique()
 template< class T, class Allocator >
 template< class BinaryPredicate >
 inline list<T, Allocator>::size_type list<T, Allocator>::unique(BinaryPredicate p)
+{
+	list graveyard(m_alloc);
+	return unique(p, graveyard);
+}
+
+template< class T, class Allocator >
+inline list<T, Allocator>::size_type list<T, Allocator>::unique(list& graveyard)
+{
+	return unique(
+		[](const auto& lhs, const auto& rhs)
+		{
+			return lhs == rhs;
+		},
+		graveyard
+	);
+}
+
+template< class T, class Allocator >
+template< class BinaryPredicate >
+inline list<T, Allocator>::size_type list<T, Allocator>::unique(BinaryPredicate p, list& graveyard)
 {
 	if (empty()) return 0;
 
 	size_type counter = 0;
 
-	for (auto it = std::next(begin()); it != end();)
+	for (auto kept = begin(), it = std::next(kept); it != end();)
 	{
-		if (p(*std::prev(it), *it))
-		{
-			it = erase(it);
-			++counter;
-		}
-		else
+		if (!p(*kept, *it))
 		{
-			++it;
+			kept = it++;
+			continue;
 		}
+
+		auto run_first = it;
+		for (++it, ++counter; it != end() && p(*kept, *it); ++it) ++counter;
+
+		graveyard.splice(graveyard.end(), *this, run_first, it);
 	}
 	return counter;
 }
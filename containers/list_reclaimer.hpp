@@ -0,0 +1,129 @@
+#ifndef _LIST_RECLAIMER_HPP_
+#define _LIST_RECLAIMER_HPP_
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "list.hpp"
+
+
+// Bulk destruction of list nodes off the hot path.
+// retire() splices a graveyard filled by the deferred remove/remove_if/unique/clear
+// overloads in O(1), the nodes are destroyed later by reclaim() or by the
+// background thread. Nodes change owner by splicing, so the lists handed in must
+// use allocators that compare equal to the reclaimer's one.
+template< class T, class Allocator = std::allocator<T> >
+class list_reclaimer
+{
+public:
+    using list_type = list<T, Allocator>;
+    using size_type = typename list_type::size_type;
+
+public:
+    explicit list_reclaimer( bool background = true );
+    list_reclaimer( const list_reclaimer& ) = delete;
+    list_reclaimer& operator=( const list_reclaimer& ) = delete;
+    ~list_reclaimer();
+
+    void retire( list_type& graveyard );
+    void retire( list_type&& graveyard ) { retire(graveyard); }
+
+    // destroys everything retired so far on the calling thread
+    void reclaim();
+
+    // blocks until the background thread has destroyed everything retired so far
+    void wait_idle();
+
+private:
+    void run();
+
+    list_type m_pending;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_idle;
+    bool m_busy = false;
+    bool m_stop = false;
+    std::thread m_worker;
+};
+
+template< class T, class Allocator >
+inline list_reclaimer<T, Allocator>::list_reclaimer( bool background )
+{
+    if (background) m_worker = std::thread(&list_reclaimer::run, this);
+}
+
+template< class T, class Allocator >
+inline list_reclaimer<T, Allocator>::~list_reclaimer()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_one();
+
+    if (m_worker.joinable()) m_worker.join();
+    m_pending.clear();
+}
+
+template< class T, class Allocator >
+inline void list_reclaimer<T, Allocator>::retire( list_type& graveyard )
+{
+    if (graveyard.empty()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_pending.splice(m_pending.end(), graveyard);
+    }
+    m_wakeup.notify_one();
+}
+
+template< class T, class Allocator >
+inline void list_reclaimer<T, Allocator>::reclaim()
+{
+    list_type victims;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        victims.splice(victims.end(), m_pending);
+    }
+    victims.clear();
+}
+
+template< class T, class Allocator >
+inline void list_reclaimer<T, Allocator>::wait_idle()
+{
+    if (!m_worker.joinable())
+    {
+        reclaim();
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending.empty() && !m_busy; });
+}
+
+template< class T, class Allocator >
+inline void list_reclaimer<T, Allocator>::run()
+{
+    list_type victims;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (true)
+    {
+        m_wakeup.wait(lock, [this] { return m_stop || !m_pending.empty(); });
+        if (m_pending.empty() && m_stop) break;
+
+        victims.splice(victims.end(), m_pending);
+        m_busy = true;
+
+        lock.unlock();
+        victims.clear();
+        lock.lock();
+
+        m_busy = false;
+        m_idle.notify_all();
+    }
+}
+
+#endif // !_LIST_RECLAIMER_HPP_
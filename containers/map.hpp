@@ -0,0 +1,256 @@
+#ifndef _MAP_HPP_
+#define _MAP_HPP_
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "set.hpp"
+
+
+// orders map entries by key and compares bare keys against entries, which
+// makes the key lookups of set usable on a tree of entries
+template< class Key, class T, class Compare >
+struct map_entry_compare
+{
+    using is_transparent = void;
+    using entry = std::pair<const Key, T>;
+
+    [[no_unique_address]] Compare comp;
+
+    bool operator () ( const entry& a, const entry& b ) const { return comp(a.first, b.first); }
+    bool operator () ( const Key& a, const entry& b ) const { return comp(a, b.first); }
+    bool operator () ( const entry& a, const Key& b ) const { return comp(a.first, b); }
+};
+
+
+// Ordered key/value map on set's AVL tree: the entries are the tree's keys,
+// ordered by their first member, so balancing, iteration and erase are set's
+// own. try_emplace, insert_or_assign and operator[] find the key and the place
+// to link a new entry in the same descent, and build the mapped value only
+// when the key is missing.
+template< class Key, class T, class Compare = std::less<Key>, class Allocator = std::allocator<std::pair<const Key, T>> >
+class map
+{
+public:
+    using key_type = Key;
+    using mapped_type = T;
+    using value_type = std::pair<const Key, T>;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using allocator_type = Allocator;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+
+private:
+    using tree_type = set<value_type, map_entry_compare<Key, T, Compare>, Allocator>;
+    using base_node = typename tree_type::base_node;
+    using avl_node = typename tree_type::avl_node;
+
+    class const_entry_iter;
+
+public:
+    using iterator = typename tree_type::iterator;
+    using const_iterator = const_entry_iter;
+
+public:
+    // constructors
+    map() = default;
+    explicit map( const Compare& comp, const Allocator& alloc = Allocator() ) : m_tree(map_entry_compare<Key, T, Compare>{ comp }, alloc) {}
+    explicit map( const Allocator& alloc ) : m_tree(alloc) {}
+    // entries are not assignable, so they are inserted at the end hint rather than
+    // staged and sorted as set does: linear for sorted input, the first of equal keys wins
+    template< std::input_iterator InputIt >
+    map( InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator() )
+        : map(comp, alloc) { insert(first, last); }
+    map( std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator() )
+        : map(init.begin(), init.end(), comp, alloc) {}
+
+    allocator_type get_allocator() const noexcept { return m_tree.get_allocator(); }
+
+    // element access
+    T& at( const Key& key );
+    const T& at( const Key& key ) const;
+    T& operator [] ( const Key& key ) { return try_emplace(key).first->second; }
+    T& operator [] ( Key&& key ) { return try_emplace(std::move(key)).first->second; }
+
+    // iterators
+    iterator begin() noexcept { return m_tree.begin(); }
+    const_iterator begin() const noexcept { return const_iterator(m_tree.begin().m_node); }
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return m_tree.end(); }
+    const_iterator end() const noexcept { return const_iterator(m_tree.end().m_node); }
+    const_iterator cend() const noexcept { return end(); }
+
+    // capacity
+    [[nodiscard]] bool empty() const noexcept { return m_tree.empty(); }
+    size_type size() const noexcept { return m_tree.size(); }
+
+    // modifiers
+    void clear() noexcept { m_tree.clear(); }
+
+    std::pair<iterator, bool> insert( const value_type& value ) { return m_tree.insert(value); }
+    std::pair<iterator, bool> insert( value_type&& value ) { return m_tree.insert(std::move(value)); }
+    iterator insert( const_iterator hint, const value_type& value ) { return m_tree.insert(tree_pos(hint), value); }
+    iterator insert( const_iterator hint, value_type&& value ) { return m_tree.insert(tree_pos(hint), std::move(value)); }
+    template< std::input_iterator InputIt >
+    void insert( InputIt first, InputIt last ) { for (; first != last; ++first) m_tree.insert(m_tree.end(), *first); }
+    // the entry is built before its key can be looked up, prefer try_emplace
+    template< class... Args >
+    std::pair<iterator, bool> emplace( Args&&... args ) { return m_tree.emplace(std::forward<Args>(args)...); }
+
+    // one descent; the mapped value is built from args only if key is missing
+    template< class... Args >
+    std::pair<iterator, bool> try_emplace( const Key& key, Args&&... args ) { return emplace_key(key, std::forward<Args>(args)...); }
+    template< class... Args >
+    std::pair<iterator, bool> try_emplace( Key&& key, Args&&... args ) { return emplace_key(std::move(key), std::forward<Args>(args)...); }
+    template< class... Args >
+    iterator try_emplace( const_iterator hint, const Key& key, Args&&... args ) { return emplace_key_hint(hint, key, std::forward<Args>(args)...); }
+    template< class... Args >
+    iterator try_emplace( const_iterator hint, Key&& key, Args&&... args ) { return emplace_key_hint(hint, std::move(key), std::forward<Args>(args)...); }
+
+    // one descent; assigns obj to the mapped value of a present key
+    template< class M >
+    std::pair<iterator, bool> insert_or_assign( const Key& key, M&& obj ) { return assign_key(key, std::forward<M>(obj)); }
+    template< class M >
+    std::pair<iterator, bool> insert_or_assign( Key&& key, M&& obj ) { return assign_key(std::move(key), std::forward<M>(obj)); }
+
+    iterator erase( const_iterator pos ) { return m_tree.erase(tree_pos(pos)); }
+    size_type erase( const Key& key ) { return m_tree.erase(key); }
+
+    void swap( map& other ) noexcept { m_tree.swap(other.m_tree); }
+
+    // lookup
+    iterator find( const Key& key ) { return m_tree.find(key); }
+    const_iterator find( const Key& key ) const { return const_iterator(m_tree.find(key).m_node); }
+    bool contains( const Key& key ) const { return m_tree.contains(key); }
+    size_type count( const Key& key ) const { return m_tree.contains(key) ? 1 : 0; }
+
+    iterator lower_bound( const Key& key ) { return m_tree.lower_bound(key); }
+    const_iterator lower_bound( const Key& key ) const { return const_iterator(m_tree.lower_bound(key).m_node); }
+    iterator upper_bound( const Key& key ) { return m_tree.upper_bound(key); }
+    const_iterator upper_bound( const Key& key ) const { return const_iterator(m_tree.upper_bound(key).m_node); }
+    std::pair<iterator, iterator> equal_range( const Key& key ) { return m_tree.equal_range(key); }
+    std::pair<const_iterator, const_iterator> equal_range( const Key& key ) const { return std::make_pair(lower_bound(key), upper_bound(key)); }
+
+    // observers
+    key_compare key_comp() const { return m_tree.key_comp().comp; }
+
+    bool operator == ( const map& other ) const { return size() == other.size() && std::equal(begin(), end(), other.begin()); }
+    bool operator != ( const map& other ) const { return !(*this == other); }
+
+private:
+    // set's const_iterator is a const tree_iter, which still hands out mutable
+    // entries and cannot be stepped, so map has its own
+    class const_entry_iter
+    {
+    private:
+        friend class map;
+
+        explicit const_entry_iter( base_node* node ) : m_node(node) {}
+
+        base_node* m_node = nullptr;
+
+    public:
+        using value_type = map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference = const value_type&;
+        using pointer = const value_type*;
+        using iterator_category = std::bidirectional_iterator_tag;
+
+        const_entry_iter() = default;
+        const_entry_iter( const iterator& it ) : m_node(it.m_node) {}
+
+        reference operator * () const noexcept { return static_cast<avl_node*>(m_node)->key; }
+        pointer operator -> () const noexcept { return &static_cast<avl_node*>(m_node)->key; }
+        const_entry_iter& operator ++ () { m_node = tree_type::next(m_node); return *this; }
+        const_entry_iter& operator -- () { m_node = tree_type::prev(m_node); return *this; }
+        const_entry_iter operator ++ (int) { const_entry_iter tmp = *this; ++(*this); return tmp; }
+        const_entry_iter operator -- (int) { const_entry_iter tmp = *this; --(*this); return tmp; }
+
+        friend bool operator == ( const const_entry_iter& a, const const_entry_iter& b ) { return a.m_node == b.m_node; }
+        friend bool operator != ( const const_entry_iter& a, const const_entry_iter& b ) { return a.m_node != b.m_node; }
+    };
+
+    static iterator tree_pos( const_iterator pos ) { return iterator(pos.m_node); }
+
+    template< class K, class... Args >
+    std::pair<iterator, bool> emplace_key( K&& key, Args&&... args );
+    template< class K, class... Args >
+    iterator emplace_key_hint( const_iterator hint, K&& key, Args&&... args );
+    template< class K, class M >
+    std::pair<iterator, bool> assign_key( K&& key, M&& obj );
+
+    template< class K, class... Args >
+    avl_node* create_entry( base_node* parent, K&& key, Args&&... args )
+    {
+        return m_tree.create_node(parent, std::piecewise_construct, std::forward_as_tuple(std::forward<K>(key)), std::forward_as_tuple(std::forward<Args>(args)...));
+    }
+
+    tree_type m_tree;
+};
+
+template< class Key, class T, class Compare, class Allocator >
+inline T& map<Key, T, Compare, Allocator>::at( const Key& key )
+{
+    iterator it = find(key);
+    if (it == end()) throw std::out_of_range("map::at: key not found");
+    return it->second;
+}
+
+template< class Key, class T, class Compare, class Allocator >
+inline const T& map<Key, T, Compare, Allocator>::at( const Key& key ) const
+{
+    const_iterator it = find(key);
+    if (it == end()) throw std::out_of_range("map::at: key not found");
+    return it->second;
+}
+
+template< class Key, class T, class Compare, class Allocator >
+template< class K, class... Args >
+inline std::pair<typename map<Key, T, Compare, Allocator>::iterator, bool> map<Key, T, Compare, Allocator>::emplace_key( K&& key, Args&&... args )
+{
+    base_node* parent;
+    bool left;
+    if (base_node* existing = m_tree.insert_position(key, parent, left)) return std::make_pair(iterator(existing), false);
+
+    avl_node* node = create_entry(parent, std::forward<K>(key), std::forward<Args>(args)...);
+    return std::make_pair(iterator(m_tree.link_node(node, parent, left)), true);
+}
+
+template< class Key, class T, class Compare, class Allocator >
+template< class K, class... Args >
+inline map<Key, T, Compare, Allocator>::iterator map<Key, T, Compare, Allocator>::emplace_key_hint( const_iterator hint, K&& key, Args&&... args )
+{
+    base_node* parent;
+    bool left;
+    if (base_node* existing = m_tree.hint_position(tree_pos(hint), key, parent, left)) return iterator(existing);
+
+    avl_node* node = create_entry(parent, std::forward<K>(key), std::forward<Args>(args)...);
+    return iterator(m_tree.link_node(node, parent, left));
+}
+
+template< class Key, class T, class Compare, class Allocator >
+template< class K, class M >
+inline std::pair<typename map<Key, T, Compare, Allocator>::iterator, bool> map<Key, T, Compare, Allocator>::assign_key( K&& key, M&& obj )
+{
+    base_node* parent;
+    bool left;
+    if (base_node* existing = m_tree.insert_position(key, parent, left))
+    {
+        static_cast<avl_node*>(existing)->key.second = std::forward<M>(obj);
+        return std::make_pair(iterator(existing), false);
+    }
+
+    avl_node* node = create_entry(parent, std::forward<K>(key), std::forward<M>(obj));
+    return std::make_pair(iterator(m_tree.link_node(node, parent, left)), true);
+}
+
+#endif // !_MAP_HPP_
@@ -0,0 +1,541 @@
+#ifndef _PERSISTENT_SET_HPP_
+#define _PERSISTENT_SET_HPP_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+
+// Ordered set whose versions share structure. The tree is set's AVL tree
+// without parent links: nodes are immutable once shared and carry an atomic
+// reference count, so copying a persistent_set is an O(1) snapshot and an
+// update copies only the O(log n) nodes on its path (path copying). Nodes that
+// only this version references are updated in place instead, so a set that was
+// never snapshotted costs no more allocations than set.
+//
+// One persistent_set object is not thread safe, but different objects are,
+// whatever nodes they share: a snapshot can be handed to a reader thread while
+// the writer keeps updating the original, and neither ever waits on the other.
+// Iterators walk a fixed version; updating the object they came from
+// invalidates them, a snapshot taken first does not.
+template< class Key, class Compare = std::less<Key>, class Allocator = std::allocator<Key> >
+class persistent_set
+{
+private:
+    struct node;
+    class tree_iter;
+
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
+    using reference = const Key&;
+    using const_reference = const Key&;
+    using iterator = tree_iter;
+    using const_iterator = tree_iter;
+
+    // an AVL tree 92 levels deep would need more than 2^64 nodes
+    static constexpr int max_depth = 92;
+
+public:
+    persistent_set() = default;
+    explicit persistent_set( const Compare& comp, const Allocator& alloc = Allocator() ) : m_comp(comp), m_alloc(alloc) {}
+    template< std::input_iterator InputIt >
+    persistent_set( InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator() );
+    persistent_set( std::initializer_list<Key> ilist, const Compare& comp = Compare(), const Allocator& alloc = Allocator() )
+        : persistent_set(ilist.begin(), ilist.end(), comp, alloc) {}
+
+    // copies are snapshots and share every node
+    persistent_set( const persistent_set& other );
+    persistent_set( persistent_set&& other ) noexcept;
+    persistent_set& operator=( const persistent_set& other );
+    persistent_set& operator=( persistent_set&& other ) noexcept;
+    ~persistent_set() { release(m_root); }
+
+    persistent_set snapshot() const { return *this; }
+
+    // iterators
+    iterator begin() const;
+    iterator end() const { return iterator(); }
+
+    // capacity
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    size_type size() const noexcept { return m_size; }
+
+    // modifiers, O(log n) new nodes where the path is shared
+    bool insert( const value_type& key );
+    bool insert( value_type&& key );
+    size_type erase( const key_type& key );
+    void clear();
+    void swap( persistent_set& other ) noexcept;
+
+    // lookup
+    bool contains( const key_type& key ) const { return find_node(key) != nullptr; }
+    iterator find( const key_type& key ) const;
+    iterator lower_bound( const key_type& key ) const;
+
+    // calls fn on every key in [lo, hi) in order
+    template< class Fn >
+    void for_each_in_range( const key_type& lo, const key_type& hi, Fn fn ) const;
+
+    allocator_type get_allocator() const { return allocator_type(m_alloc); }
+
+private:
+    struct node
+    {
+        Key key;
+        node* left = nullptr;
+        node* right = nullptr;
+        std::atomic<size_t> refs{ 1 };
+        int height = 1;
+
+        template< class... Args >
+        node( Args&&... args ) : key(std::forward<Args>(args)...) {}
+    };
+
+    // in-order walk over a fixed version, the stack holds the path of nodes
+    // whose right subtree is still ahead
+    class tree_iter
+    {
+    private:
+        friend class persistent_set;
+
+        node* m_stack[max_depth];
+        int m_depth = 0;
+
+        void push_left( node* n )
+        {
+            for (; n != nullptr; n = n->left) m_stack[m_depth++] = n;
+        }
+
+    public:
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using reference = const Key&;
+        using pointer = const Key*;
+        using iterator_category = std::forward_iterator_tag;
+
+        tree_iter() = default;
+
+        reference operator*() const { return m_stack[m_depth - 1]->key; }
+        pointer operator->() const { return &m_stack[m_depth - 1]->key; }
+
+        tree_iter& operator++()
+        {
+            node* done = m_stack[--m_depth];
+            push_left(done->right);
+            return *this;
+        }
+
+        tree_iter operator++( int )
+        {
+            tree_iter old = *this;
+            ++*this;
+            return old;
+        }
+
+        bool operator==( const tree_iter& other ) const
+        {
+            if (m_depth == 0 || other.m_depth == 0) return m_depth == other.m_depth;
+            return m_stack[m_depth - 1] == other.m_stack[other.m_depth - 1];
+        }
+    };
+
+    template< class... Args >
+    node* create_node( Args&&... args );
+    void destroy_node( node* n );
+
+    static node* retain( node* n )
+    {
+        if (n != nullptr) n->refs.fetch_add(1, std::memory_order_relaxed);
+        return n;
+    }
+    void release( node* n );
+
+    // takes over a reference to n and returns a node only this version references
+    node* unshare( node* n );
+
+    static int height( const node* n ) { return n == nullptr ? 0 : n->height; }
+    static void fix_height( node* n ) { n->height = 1 + std::max(height(n->left), height(n->right)); }
+
+    // these update the tree through the link that holds a node, and every copy
+    // is linked in before going deeper, so a failed allocation leaves a valid
+    // tree (possibly less balanced) with correct reference counts
+    void rotate_left( node*& link );
+    void rotate_right( node*& link );
+    void balance( node*& link );
+    template< class K >
+    void insert_at( node*& link, K&& key );
+    void erase_at( node*& link, const key_type& key );
+    void remove_min( node*& link, node*& min );
+
+    node* build_sorted( const Key* first, size_type count );
+    const node* find_node( const key_type& key ) const;
+
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<node>;
+    using node_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<node>;
+
+    node* m_root = nullptr;
+    size_type m_size = 0;
+    [[no_unique_address]] Compare m_comp;
+    [[no_unique_address]] node_allocator m_alloc;
+};
+
+template< class Key, class Compare, class Allocator >
+template< std::input_iterator InputIt >
+inline persistent_set<Key, Compare, Allocator>::persistent_set( InputIt first, InputIt last, const Compare& comp, const Allocator& alloc )
+    : m_comp(comp), m_alloc(alloc)
+{
+    // sorted and deduplicated up front, then built in O(n) like set does
+    std::vector<Key> keys(first, last);
+    std::stable_sort(keys.begin(), keys.end(), m_comp);
+    auto same = [this]( const Key& a, const Key& b ) { return !m_comp(a, b) && !m_comp(b, a); };
+    keys.erase(std::unique(keys.begin(), keys.end(), same), keys.end());
+
+    m_root = build_sorted(keys.data(), keys.size());
+    m_size = keys.size();
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::persistent_set( const persistent_set& other )
+    : m_root(retain(other.m_root)), m_size(other.m_size), m_comp(other.m_comp), m_alloc(other.m_alloc) {}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::persistent_set( persistent_set&& other ) noexcept
+    : m_root(std::exchange(other.m_root, nullptr)), m_size(std::exchange(other.m_size, 0)), m_comp(other.m_comp), m_alloc(other.m_alloc) {}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>& persistent_set<Key, Compare, Allocator>::operator=( const persistent_set& other )
+{
+    // nodes must be freed by the allocator that made them, so it travels with them
+    node* old = m_root;
+    m_root = retain(other.m_root);
+    m_size = other.m_size;
+    release(old);
+
+    m_comp = other.m_comp;
+    m_alloc = other.m_alloc;
+    return *this;
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>& persistent_set<Key, Compare, Allocator>::operator=( persistent_set&& other ) noexcept
+{
+    swap(other);
+    return *this;
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::iterator persistent_set<Key, Compare, Allocator>::begin() const
+{
+    iterator it;
+    it.push_left(m_root);
+    return it;
+}
+
+template< class Key, class Compare, class Allocator >
+inline bool persistent_set<Key, Compare, Allocator>::insert( const value_type& key )
+{
+    // a duplicate must not copy the path it would have changed
+    if (contains(key)) return false;
+
+    insert_at(m_root, key);
+    return true;
+}
+
+template< class Key, class Compare, class Allocator >
+inline bool persistent_set<Key, Compare, Allocator>::insert( value_type&& key )
+{
+    if (contains(key)) return false;
+
+    insert_at(m_root, std::move(key));
+    return true;
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::size_type persistent_set<Key, Compare, Allocator>::erase( const key_type& key )
+{
+    if (!contains(key)) return 0;
+
+    erase_at(m_root, key);
+    return 1;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::clear()
+{
+    release(std::exchange(m_root, nullptr));
+    m_size = 0;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::swap( persistent_set& other ) noexcept
+{
+    std::swap(m_root, other.m_root);
+    std::swap(m_size, other.m_size);
+    std::swap(m_comp, other.m_comp);
+    std::swap(m_alloc, other.m_alloc);
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::iterator persistent_set<Key, Compare, Allocator>::find( const key_type& key ) const
+{
+    iterator it = lower_bound(key);
+    if (it.m_depth == 0 || m_comp(key, *it)) return end();
+    return it;
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::iterator persistent_set<Key, Compare, Allocator>::lower_bound( const key_type& key ) const
+{
+    // keep only the nodes the walk turned left at, they are the ones still ahead
+    iterator it;
+    node* n = m_root;
+    while (n != nullptr)
+    {
+        if (m_comp(n->key, key)) n = n->right;
+        else
+        {
+            it.m_stack[it.m_depth++] = n;
+            n = n->left;
+        }
+    }
+    return it;
+}
+
+template< class Key, class Compare, class Allocator >
+template< class Fn >
+inline void persistent_set<Key, Compare, Allocator>::for_each_in_range( const key_type& lo, const key_type& hi, Fn fn ) const
+{
+    for (iterator it = lower_bound(lo); it.m_depth != 0 && m_comp(*it, hi); ++it) fn(*it);
+}
+
+template< class Key, class Compare, class Allocator >
+template< class... Args >
+inline persistent_set<Key, Compare, Allocator>::node* persistent_set<Key, Compare, Allocator>::create_node( Args&&... args )
+{
+    node* n = node_allocator_traits::allocate(m_alloc, 1);
+    try
+    {
+        node_allocator_traits::construct(m_alloc, n, std::forward<Args>(args)...);
+    }
+    catch (...)
+    {
+        node_allocator_traits::deallocate(m_alloc, n, 1);
+        throw;
+    }
+    return n;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::destroy_node( node* n )
+{
+    node_allocator_traits::destroy(m_alloc, n);
+    node_allocator_traits::deallocate(m_alloc, n, 1);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::release( node* n )
+{
+    // the last owner frees the node and drops its references to the children
+    while (n != nullptr && n->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        node* right = n->right;
+        release(n->left);
+        destroy_node(n);
+        n = right;
+    }
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::node* persistent_set<Key, Compare, Allocator>::unshare( node* n )
+{
+    // acquire pairs with the release of the last other owner before n is written
+    if (n->refs.load(std::memory_order_acquire) == 1) return n;
+
+    node* copy = create_node(n->key);
+    copy->left = retain(n->left);
+    copy->right = retain(n->right);
+    copy->height = n->height;
+    release(n);
+    return copy;
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::rotate_left( node*& link )
+{
+    // link holds an unshared node, the pivot is unshared before it moves up
+    node* n = link;
+    n->right = unshare(n->right);
+
+    node* pivot = n->right;
+    n->right = pivot->left;
+    pivot->left = n;
+    link = pivot;
+
+    fix_height(n);
+    fix_height(pivot);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::rotate_right( node*& link )
+{
+    node* n = link;
+    n->left = unshare(n->left);
+
+    node* pivot = n->left;
+    n->left = pivot->right;
+    pivot->right = n;
+    link = pivot;
+
+    fix_height(n);
+    fix_height(pivot);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::balance( node*& link )
+{
+    // link holds an unshared node; the same cases as set::balance_tree
+    node* n = link;
+    int diff = height(n->left) - height(n->right);
+    if (diff > 1)
+    {
+        if (height(n->left->left) < height(n->left->right))
+        {
+            n->left = unshare(n->left);
+            rotate_left(n->left);
+        }
+        rotate_right(link);
+    }
+    else if (diff < -1)
+    {
+        if (height(n->right->right) < height(n->right->left))
+        {
+            n->right = unshare(n->right);
+            rotate_right(n->right);
+        }
+        rotate_left(link);
+    }
+    else fix_height(n);
+}
+
+template< class Key, class Compare, class Allocator >
+template< class K >
+inline void persistent_set<Key, Compare, Allocator>::insert_at( node*& link, K&& key )
+{
+    // the key is known to be missing
+    if (link == nullptr)
+    {
+        link = create_node(std::forward<K>(key));
+        ++m_size;
+        return;
+    }
+
+    node* n = link = unshare(link);
+    if (m_comp(key, n->key)) insert_at(n->left, std::forward<K>(key));
+    else insert_at(n->right, std::forward<K>(key));
+    balance(link);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::erase_at( node*& link, const key_type& key )
+{
+    // the key is known to be present
+    node* n = link = unshare(link);
+    if (m_comp(key, n->key)) erase_at(n->left, key);
+    else if (m_comp(n->key, key)) erase_at(n->right, key);
+    else if (n->right == nullptr)
+    {
+        link = n->left;
+        destroy_node(n);
+        --m_size;
+        return;
+    }
+    else
+    {
+        // the successor takes the erased node's place; once it is detached the
+        // splice cannot fail, so do it even if rebalancing on the way up threw
+        node* min = nullptr;
+        auto splice = [&] {
+            min->left = n->left;
+            min->right = n->right;
+            link = min;
+            destroy_node(n);
+            --m_size;
+        };
+
+        try
+        {
+            remove_min(n->right, min);
+        }
+        catch (...)
+        {
+            if (min != nullptr) splice();
+            throw;
+        }
+        splice();
+    }
+    balance(link);
+}
+
+template< class Key, class Compare, class Allocator >
+inline void persistent_set<Key, Compare, Allocator>::remove_min( node*& link, node*& min )
+{
+    node* n = link = unshare(link);
+    if (n->left == nullptr)
+    {
+        link = std::exchange(n->right, nullptr);
+        min = n;
+        return;
+    }
+
+    remove_min(n->left, min);
+    balance(link);
+}
+
+template< class Key, class Compare, class Allocator >
+inline persistent_set<Key, Compare, Allocator>::node* persistent_set<Key, Compare, Allocator>::build_sorted( const Key* first, size_type count )
+{
+    if (count == 0) return nullptr;
+
+    size_type mid = count / 2;
+    node* n = create_node(first[mid]);
+    try
+    {
+        n->left = build_sorted(first, mid);
+        n->right = build_sorted(first + mid + 1, count - mid - 1);
+    }
+    catch (...)
+    {
+        release(n);
+        throw;
+    }
+
+    fix_height(n);
+    return n;
+}
+
+template< class Key, class Compare, class Allocator >
+inline const persistent_set<Key, Compare, Allocator>::node* persistent_set<Key, Compare, Allocator>::find_node( const key_type& key ) const
+{
+    const node* n = m_root;
+    while (n != nullptr)
+    {
+        if (m_comp(key, n->key)) n = n->left;
+        else if (m_comp(n->key, key)) n = n->right;
+        else return n;
+    }
+    return nullptr;
+}
+
+#endif // !_PERSISTENT_SET_HPP_
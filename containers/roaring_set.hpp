@@ -0,0 +1,804 @@
+#ifndef _ROARING_SET_HPP_
+#define _ROARING_SET_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "set.hpp"
+
+
+// Roaring bitmap: a set of 32-bit unsigned integers split by their high 16 bits
+// into chunks of 64K values, each stored in whichever of three containers is
+// smallest: a sorted array of the low halves (up to 4096 of them), a 8 KiB
+// bitmap, or a list of runs. Dense keys cost a bit or less each instead of a
+// node, and set algebra on two bitmaps is a word-wise loop, done with SSE2
+// where available.
+//
+// Inserts and erases switch between array and bitmap at 4096 keys. Runs come
+// from run_optimize(), which the range constructors call, and are kept up on
+// insert and erase until they stop being the smallest form. Iteration is in
+// key order; inserts and erases invalidate iterators.
+template< class Key = std::uint32_t >
+class roaring_set
+{
+    static_assert(std::is_unsigned_v<Key> && sizeof(Key) == 4, "roaring_set keys are 32-bit unsigned integers");
+
+private:
+    class chunk_iter;
+
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using reference = const Key&;
+    using const_reference = const Key&;
+    using iterator = chunk_iter;
+    using const_iterator = chunk_iter;
+
+    // past this many keys an array chunk is larger than a bitmap
+    static constexpr size_t array_limit = 4096;
+
+public:
+    // constructors
+    roaring_set() = default;
+    template< std::input_iterator InputIt >
+    roaring_set( InputIt first, InputIt last );
+    roaring_set( std::initializer_list<Key> init ) : roaring_set(init.begin(), init.end()) {}
+    template< class Compare, class Allocator, class Augment >
+    explicit roaring_set( const set<Key, Compare, Allocator, Augment>& keys ) : roaring_set(keys.begin(), keys.end()) {}
+
+    // conversion back, built in linear time from the ordered keys
+    template< class Compare = std::less<Key>, class Allocator = std::allocator<Key> >
+    set<Key, Compare, Allocator> to_set() const { return set<Key, Compare, Allocator>(begin(), end()); }
+
+    // iterators
+    iterator begin() const { return seek(0, 0); }
+    iterator cbegin() const { return begin(); }
+    iterator end() const { return iterator(this, m_chunks.size(), 0, 0); }
+    iterator cend() const { return end(); }
+
+    // capacity
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    size_type size() const noexcept { return m_size; }
+    // bytes held by the chunk table and the containers
+    size_t memory_usage() const noexcept;
+
+    // modifiers
+    void clear() noexcept { m_chunks.clear(); m_size = 0; }
+    std::pair<iterator, bool> insert( Key key );
+    template< std::input_iterator InputIt >
+    void insert( InputIt first, InputIt last ) { for (; first != last; ++first) insert(*first); }
+    size_type erase( Key key );
+    void swap( roaring_set& other ) noexcept { m_chunks.swap(other.m_chunks); std::swap(m_size, other.m_size); }
+
+    // converts every chunk to its smallest container, true if any changed
+    bool run_optimize();
+
+    // lookup
+    iterator find( Key key ) const;
+    bool contains( Key key ) const;
+    size_type count( Key key ) const { return contains(key) ? 1 : 0; }
+
+    // set algebra, chunk by chunk
+    friend roaring_set set_union( const roaring_set& a, const roaring_set& b ) { return combine<bit_op::union_of>(a, b); }
+    friend roaring_set set_intersection( const roaring_set& a, const roaring_set& b ) { return combine<bit_op::intersection_of>(a, b); }
+    friend roaring_set set_difference( const roaring_set& a, const roaring_set& b ) { return combine<bit_op::difference_of>(a, b); }
+    // size of the intersection without building it
+    friend size_type intersection_size( const roaring_set& a, const roaring_set& b ) { return a.common_count(b); }
+
+    bool operator == ( const roaring_set& other ) const { return m_size == other.m_size && std::equal(begin(), end(), other.begin()); }
+    bool operator != ( const roaring_set& other ) const { return !(*this == other); }
+
+private:
+    static constexpr size_t bitmap_words = 65536 / 64;
+
+    enum class kind : std::uint8_t { array, bitmap, runs };
+    enum class bit_op { union_of, intersection_of, difference_of };
+
+    // the values start .. start + length
+    struct run
+    {
+        std::uint16_t start;
+        std::uint16_t length;
+
+        std::uint32_t last() const noexcept { return std::uint32_t(start) + length; }
+    };
+
+    struct chunk
+    {
+        std::uint16_t high = 0;
+        kind type = kind::array;
+        std::uint32_t cardinality = 0;
+        // only the member matching type is in use, the others stay empty
+        std::vector<std::uint16_t> values;
+        std::vector<std::uint64_t> words;
+        std::vector<run> runs;
+
+        chunk() = default;
+        explicit chunk( std::uint16_t h ) : high(h) {}
+    };
+
+    class chunk_iter
+    {
+    private:
+        friend class roaring_set;
+
+    public:
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using reference = const Key&;
+        using pointer = const Key*;
+        using iterator_category = std::forward_iterator_tag;
+
+    private:
+        chunk_iter( const roaring_set* owner, size_t chunk, std::uint32_t pos, Key value ) : m_owner(owner), m_chunk(chunk), m_pos(pos), m_value(value) {}
+
+        const roaring_set* m_owner = nullptr;
+        size_t m_chunk = 0;
+        // index into the array or the runs of the chunk, unused for bitmaps
+        std::uint32_t m_pos = 0;
+        Key m_value = 0;
+
+    public:
+        chunk_iter() = default;
+
+        reference operator * () const noexcept { return m_value; }
+        pointer operator -> () const noexcept { return &m_value; }
+
+        chunk_iter& operator ++ () { m_owner->advance(*this); return *this; }
+        chunk_iter operator ++ (int) { chunk_iter tmp = *this; ++(*this); return tmp; }
+
+        bool operator == ( const chunk_iter& other ) const noexcept { return m_chunk == other.m_chunk && m_value == other.m_value; }
+        bool operator != ( const chunk_iter& other ) const noexcept { return !(*this == other); }
+    };
+
+    static std::uint16_t high_of( Key key ) noexcept { return static_cast<std::uint16_t>(key >> 16); }
+    static std::uint16_t low_of( Key key ) noexcept { return static_cast<std::uint16_t>(key & 0xffff); }
+    static Key compose( std::uint16_t high, std::uint32_t low ) noexcept { return (Key(high) << 16) | Key(low); }
+
+    // index of the chunk for high, or of where it would go
+    size_t chunk_index( std::uint16_t high ) const;
+
+    // the first key at or after low in chunk index, or in the chunks after it
+    iterator seek( size_t index, std::uint32_t low ) const;
+    void advance( iterator& it ) const;
+
+    // per-container operations
+    static bool test_bit( const std::vector<std::uint64_t>& words, std::uint32_t bit ) noexcept { return (words[bit / 64] >> (bit % 64)) & 1; }
+    // first set bit at or after bit, 65536 if none
+    static std::uint32_t next_bit( const std::vector<std::uint64_t>& words, std::uint32_t bit ) noexcept;
+    // index of the run holding low or of the first run after it
+    static size_t run_at( const std::vector<run>& runs, std::uint16_t low ) noexcept;
+
+    static bool chunk_contains( const chunk& c, std::uint16_t low );
+    static bool chunk_insert( chunk& c, std::uint16_t low );
+    static bool chunk_erase( chunk& c, std::uint16_t low );
+
+    static size_t run_count( const chunk& c ) noexcept;
+    static size_t plain_bytes( size_t cardinality ) noexcept { return cardinality <= array_limit ? cardinality * sizeof(std::uint16_t) : bitmap_words * sizeof(std::uint64_t); }
+    static void to_array( chunk& c );
+    static void to_bitmap( chunk& c );
+    static void to_runs( chunk& c );
+    // array or bitmap, whichever is smaller for the cardinality
+    static void to_plain( chunk& c );
+    // after a run insert or erase, falls back to array or bitmap once runs stop paying off
+    static void check_runs( chunk& c );
+
+    // a copy of c as an array or a bitmap, for the set algebra
+    static chunk plain_copy( const chunk& c );
+    template< bit_op Op, bool Store >
+    static std::uint32_t combine_bitmaps( const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out ) noexcept;
+    template< bit_op Op >
+    static chunk combine_chunks( const chunk& a, const chunk& b );
+    template< bit_op Op >
+    static roaring_set combine( const roaring_set& a, const roaring_set& b );
+    size_type common_count( const roaring_set& other ) const;
+
+    std::vector<chunk> m_chunks;
+    size_t m_size = 0;
+};
+
+template< class Key >
+template< std::input_iterator InputIt >
+inline roaring_set<Key>::roaring_set( InputIt first, InputIt last )
+{
+    insert(first, last);
+    run_optimize();
+}
+
+template< class Key >
+inline size_t roaring_set<Key>::memory_usage() const noexcept
+{
+    size_t bytes = m_chunks.capacity() * sizeof(chunk);
+    for (const chunk& c : m_chunks)
+    {
+        bytes += c.values.capacity() * sizeof(std::uint16_t);
+        bytes += c.words.capacity() * sizeof(std::uint64_t);
+        bytes += c.runs.capacity() * sizeof(run);
+    }
+    return bytes;
+}
+
+template< class Key >
+inline std::pair<typename roaring_set<Key>::iterator, bool> roaring_set<Key>::insert( Key key )
+{
+    std::uint16_t high = high_of(key);
+    size_t index = chunk_index(high);
+    if (index == m_chunks.size() || m_chunks[index].high != high)
+        m_chunks.insert(m_chunks.begin() + index, chunk(high));
+
+    bool inserted = chunk_insert(m_chunks[index], low_of(key));
+    if (inserted) ++m_size;
+    return std::make_pair(seek(index, low_of(key)), inserted);
+}
+
+template< class Key >
+inline roaring_set<Key>::size_type roaring_set<Key>::erase( Key key )
+{
+    size_t index = chunk_index(high_of(key));
+    if (index == m_chunks.size() || m_chunks[index].high != high_of(key)) return 0;
+
+    chunk& c = m_chunks[index];
+    if (!chunk_erase(c, low_of(key))) return 0;
+
+    if (c.cardinality == 0) m_chunks.erase(m_chunks.begin() + index);
+    --m_size;
+    return 1;
+}
+
+template< class Key >
+inline bool roaring_set<Key>::run_optimize()
+{
+    bool changed = false;
+    for (chunk& c : m_chunks)
+    {
+        bool use_runs = run_count(c) * sizeof(run) < plain_bytes(c.cardinality);
+        if (use_runs == (c.type == kind::runs)) continue;
+
+        if (use_runs) to_runs(c);
+        else to_plain(c);
+        changed = true;
+    }
+    return changed;
+}
+
+template< class Key >
+inline roaring_set<Key>::iterator roaring_set<Key>::find( Key key ) const
+{
+    size_t index = chunk_index(high_of(key));
+    if (index == m_chunks.size() || m_chunks[index].high != high_of(key) || !chunk_contains(m_chunks[index], low_of(key))) return end();
+    return seek(index, low_of(key));
+}
+
+template< class Key >
+inline bool roaring_set<Key>::contains( Key key ) const
+{
+    size_t index = chunk_index(high_of(key));
+    return index != m_chunks.size() && m_chunks[index].high == high_of(key) && chunk_contains(m_chunks[index], low_of(key));
+}
+
+template< class Key >
+inline size_t roaring_set<Key>::chunk_index( std::uint16_t high ) const
+{
+    auto it = std::lower_bound(m_chunks.begin(), m_chunks.end(), high, []( const chunk& c, std::uint16_t h ) { return c.high < h; });
+    return static_cast<size_t>(it - m_chunks.begin());
+}
+
+template< class Key >
+inline roaring_set<Key>::iterator roaring_set<Key>::seek( size_t index, std::uint32_t low ) const
+{
+    for (; index < m_chunks.size(); ++index, low = 0)
+    {
+        const chunk& c = m_chunks[index];
+        switch (c.type)
+        {
+        case kind::array:
+        {
+            auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+            if (it != c.values.end()) return iterator(this, index, static_cast<std::uint32_t>(it - c.values.begin()), compose(c.high, *it));
+            break;
+        }
+        case kind::bitmap:
+        {
+            std::uint32_t bit = next_bit(c.words, low);
+            if (bit < 65536) return iterator(this, index, 0, compose(c.high, bit));
+            break;
+        }
+        case kind::runs:
+        {
+            if (low > 0xffff) break;
+            size_t at = run_at(c.runs, static_cast<std::uint16_t>(low));
+            if (at == c.runs.size()) break;
+            return iterator(this, index, static_cast<std::uint32_t>(at), compose(c.high, std::max<std::uint32_t>(low, c.runs[at].start)));
+        }
+        }
+    }
+    return end();
+}
+
+template< class Key >
+inline void roaring_set<Key>::advance( iterator& it ) const
+{
+    const chunk& c = m_chunks[it.m_chunk];
+    std::uint32_t low = low_of(it.m_value);
+    switch (c.type)
+    {
+    case kind::array:
+        if (++it.m_pos < c.values.size())
+        {
+            it.m_value = compose(c.high, c.values[it.m_pos]);
+            return;
+        }
+        break;
+    case kind::bitmap:
+        if (std::uint32_t bit = next_bit(c.words, low + 1); bit < 65536)
+        {
+            it.m_value = compose(c.high, bit);
+            return;
+        }
+        break;
+    case kind::runs:
+        if (low < c.runs[it.m_pos].last())
+        {
+            ++it.m_value;
+            return;
+        }
+        if (++it.m_pos < c.runs.size())
+        {
+            it.m_value = compose(c.high, c.runs[it.m_pos].start);
+            return;
+        }
+        break;
+    }
+    it = seek(it.m_chunk + 1, 0);
+}
+
+template< class Key >
+inline std::uint32_t roaring_set<Key>::next_bit( const std::vector<std::uint64_t>& words, std::uint32_t bit ) noexcept
+{
+    if (bit >= 65536) return 65536;
+
+    size_t w = bit / 64;
+    std::uint64_t mask = words[w] & (~std::uint64_t(0) << (bit % 64));
+    while (mask == 0)
+    {
+        if (++w == bitmap_words) return 65536;
+        mask = words[w];
+    }
+    return static_cast<std::uint32_t>(w * 64 + std::countr_zero(mask));
+}
+
+template< class Key >
+inline size_t roaring_set<Key>::run_at( const std::vector<run>& runs, std::uint16_t low ) noexcept
+{
+    // the last run starting at or before low, if it reaches low
+    auto it = std::upper_bound(runs.begin(), runs.end(), low, []( std::uint16_t l, const run& r ) { return l < r.start; });
+    if (it != runs.begin() && std::prev(it)->last() >= low) --it;
+    return static_cast<size_t>(it - runs.begin());
+}
+
+template< class Key >
+inline bool roaring_set<Key>::chunk_contains( const chunk& c, std::uint16_t low )
+{
+    switch (c.type)
+    {
+    case kind::array:
+        return std::binary_search(c.values.begin(), c.values.end(), low);
+    case kind::bitmap:
+        return test_bit(c.words, low);
+    case kind::runs:
+    {
+        size_t at = run_at(c.runs, low);
+        return at != c.runs.size() && c.runs[at].start <= low;
+    }
+    }
+    return false;
+}
+
+template< class Key >
+inline bool roaring_set<Key>::chunk_insert( chunk& c, std::uint16_t low )
+{
+    switch (c.type)
+    {
+    case kind::array:
+    {
+        auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+        if (it != c.values.end() && *it == low) return false;
+
+        if (c.cardinality < array_limit)
+        {
+            c.values.insert(it, low);
+            ++c.cardinality;
+            return true;
+        }
+        to_bitmap(c);
+        [[fallthrough]];
+    }
+    case kind::bitmap:
+        if (test_bit(c.words, low)) return false;
+        c.words[low / 64] |= std::uint64_t(1) << (low % 64);
+        ++c.cardinality;
+        return true;
+    case kind::runs:
+    {
+        size_t at = run_at(c.runs, low);
+        if (at != c.runs.size() && c.runs[at].start <= low) return false;
+
+        // grow the run ending just before low or the one starting just after it, or both into one
+        bool joins_prev = at > 0 && c.runs[at - 1].last() + 1 == low;
+        bool joins_next = at < c.runs.size() && c.runs[at].start == low + 1;
+        if (joins_prev && joins_next)
+        {
+            c.runs[at - 1].length += c.runs[at].length + 2;
+            c.runs.erase(c.runs.begin() + at);
+        }
+        else if (joins_prev) ++c.runs[at - 1].length;
+        else if (joins_next)
+        {
+            --c.runs[at].start;
+            ++c.runs[at].length;
+        }
+        else c.runs.insert(c.runs.begin() + at, run{ low, 0 });
+
+        ++c.cardinality;
+        check_runs(c);
+        return true;
+    }
+    }
+    return false;
+}
+
+template< class Key >
+inline bool roaring_set<Key>::chunk_erase( chunk& c, std::uint16_t low )
+{
+    switch (c.type)
+    {
+    case kind::array:
+    {
+        auto it = std::lower_bound(c.values.begin(), c.values.end(), low);
+        if (it == c.values.end() || *it != low) return false;
+
+        c.values.erase(it);
+        --c.cardinality;
+        return true;
+    }
+    case kind::bitmap:
+        if (!test_bit(c.words, low)) return false;
+
+        c.words[low / 64] &= ~(std::uint64_t(1) << (low % 64));
+        if (--c.cardinality <= array_limit) to_array(c);
+        return true;
+    case kind::runs:
+    {
+        size_t at = run_at(c.runs, low);
+        if (at == c.runs.size() || c.runs[at].start > low) return false;
+
+        run& r = c.runs[at];
+        if (r.length == 0) c.runs.erase(c.runs.begin() + at);
+        else if (r.start == low)
+        {
+            ++r.start;
+            --r.length;
+        }
+        else if (r.last() == low) --r.length;
+        else
+        {
+            // split around low
+            run after{ static_cast<std::uint16_t>(low + 1), static_cast<std::uint16_t>(r.last() - low - 1) };
+            r.length = static_cast<std::uint16_t>(low - r.start - 1);
+            c.runs.insert(c.runs.begin() + at + 1, after);
+        }
+
+        --c.cardinality;
+        check_runs(c);
+        return true;
+    }
+    }
+    return false;
+}
+
+template< class Key >
+inline size_t roaring_set<Key>::run_count( const chunk& c ) noexcept
+{
+    size_t count = 0;
+    switch (c.type)
+    {
+    case kind::array:
+        for (size_t i = 0; i < c.values.size(); ++i)
+            count += i == 0 || c.values[i] != c.values[i - 1] + 1;
+        break;
+    case kind::bitmap:
+    {
+        // a run starts at every set bit whose lower neighbour is clear
+        std::uint64_t carry = 0;
+        for (std::uint64_t w : c.words)
+        {
+            count += std::popcount(w & ~((w << 1) | carry));
+            carry = w >> 63;
+        }
+        break;
+    }
+    case kind::runs:
+        count = c.runs.size();
+        break;
+    }
+    return count;
+}
+
+template< class Key >
+inline void roaring_set<Key>::to_array( chunk& c )
+{
+    std::vector<std::uint16_t> values;
+    values.reserve(c.cardinality);
+    if (c.type == kind::bitmap)
+    {
+        for (std::uint32_t bit = next_bit(c.words, 0); bit < 65536; bit = next_bit(c.words, bit + 1))
+            values.push_back(static_cast<std::uint16_t>(bit));
+    }
+    else if (c.type == kind::runs)
+    {
+        for (const run& r : c.runs)
+            for (std::uint32_t v = r.start; v <= r.last(); ++v) values.push_back(static_cast<std::uint16_t>(v));
+    }
+    else return;
+
+    c.values = std::move(values);
+    std::vector<std::uint64_t>().swap(c.words);
+    std::vector<run>().swap(c.runs);
+    c.type = kind::array;
+}
+
+template< class Key >
+inline void roaring_set<Key>::to_bitmap( chunk& c )
+{
+    std::vector<std::uint64_t> words(bitmap_words, 0);
+    if (c.type == kind::array)
+    {
+        for (std::uint16_t v : c.values) words[v / 64] |= std::uint64_t(1) << (v % 64);
+    }
+    else if (c.type == kind::runs)
+    {
+        for (const run& r : c.runs)
+            for (std::uint32_t v = r.start; v <= r.last(); ++v) words[v / 64] |= std::uint64_t(1) << (v % 64);
+    }
+    else return;
+
+    c.words = std::move(words);
+    std::vector<std::uint16_t>().swap(c.values);
+    std::vector<run>().swap(c.runs);
+    c.type = kind::bitmap;
+}
+
+template< class Key >
+inline void roaring_set<Key>::to_runs( chunk& c )
+{
+    std::vector<run> runs;
+    runs.reserve(run_count(c));
+    auto append = [&runs]( std::uint32_t v ) {
+        if (!runs.empty() && runs.back().last() + 1 == v) ++runs.back().length;
+        else runs.push_back(run{ static_cast<std::uint16_t>(v), 0 });
+    };
+
+    if (c.type == kind::array)
+    {
+        for (std::uint16_t v : c.values) append(v);
+    }
+    else if (c.type == kind::bitmap)
+    {
+        for (std::uint32_t bit = next_bit(c.words, 0); bit < 65536; bit = next_bit(c.words, bit + 1)) append(bit);
+    }
+    else return;
+
+    c.runs = std::move(runs);
+    std::vector<std::uint16_t>().swap(c.values);
+    std::vector<std::uint64_t>().swap(c.words);
+    c.type = kind::runs;
+}
+
+template< class Key >
+inline void roaring_set<Key>::to_plain( chunk& c )
+{
+    if (c.cardinality <= array_limit) to_array(c);
+    else to_bitmap(c);
+}
+
+template< class Key >
+inline void roaring_set<Key>::check_runs( chunk& c )
+{
+    if (c.runs.size() * sizeof(run) > plain_bytes(c.cardinality)) to_plain(c);
+}
+
+template< class Key >
+inline roaring_set<Key>::chunk roaring_set<Key>::plain_copy( const chunk& c )
+{
+    chunk copy = c;
+    if (c.type == kind::runs) to_plain(copy);
+    return copy;
+}
+
+template< class Key >
+template< typename roaring_set<Key>::bit_op Op, bool Store >
+inline std::uint32_t roaring_set<Key>::combine_bitmaps( const std::uint64_t* a, const std::uint64_t* b, std::uint64_t* out ) noexcept
+{
+    std::uint32_t cardinality = 0;
+#if defined(__SSE2__)
+    for (size_t i = 0; i < bitmap_words; i += 2)
+    {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i));
+        __m128i r;
+        if constexpr (Op == bit_op::union_of) r = _mm_or_si128(x, y);
+        else if constexpr (Op == bit_op::intersection_of) r = _mm_and_si128(x, y);
+        else r = _mm_andnot_si128(y, x);
+
+        alignas(16) std::uint64_t lanes[2];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanes), r);
+        if constexpr (Store)
+        {
+            out[i] = lanes[0];
+            out[i + 1] = lanes[1];
+        }
+        cardinality += std::popcount(lanes[0]) + std::popcount(lanes[1]);
+    }
+#else
+    for (size_t i = 0; i < bitmap_words; ++i)
+    {
+        std::uint64_t r;
+        if constexpr (Op == bit_op::union_of) r = a[i] | b[i];
+        else if constexpr (Op == bit_op::intersection_of) r = a[i] & b[i];
+        else r = a[i] & ~b[i];
+
+        if constexpr (Store) out[i] = r;
+        cardinality += std::popcount(r);
+    }
+#endif
+    return cardinality;
+}
+
+template< class Key >
+template< typename roaring_set<Key>::bit_op Op >
+inline roaring_set<Key>::chunk roaring_set<Key>::combine_chunks( const chunk& a, const chunk& b )
+{
+    // only a run side is converted, arrays and bitmaps are read in place
+    if (a.type == kind::runs) return combine_chunks<Op>(plain_copy(a), b);
+    if (b.type == kind::runs) return combine_chunks<Op>(a, plain_copy(b));
+
+    chunk result(a.high);
+
+    if (a.type == kind::bitmap && b.type == kind::bitmap)
+    {
+        result.type = kind::bitmap;
+        result.words.resize(bitmap_words);
+        result.cardinality = combine_bitmaps<Op, true>(a.words.data(), b.words.data(), result.words.data());
+    }
+    else if (a.type == kind::array && b.type == kind::array)
+    {
+        auto out = std::back_inserter(result.values);
+        if constexpr (Op == bit_op::union_of) std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), out);
+        else if constexpr (Op == bit_op::intersection_of) std::set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), out);
+        else std::set_difference(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(), out);
+        result.cardinality = static_cast<std::uint32_t>(result.values.size());
+    }
+    else if constexpr (Op == bit_op::union_of)
+    {
+        // the bitmap side with the array's bits added
+        result = a.type == kind::bitmap ? a : b;
+        for (std::uint16_t v : (a.type == kind::array ? a : b).values)
+        {
+            std::uint64_t bit = std::uint64_t(1) << (v % 64);
+            result.cardinality += (result.words[v / 64] & bit) == 0;
+            result.words[v / 64] |= bit;
+        }
+    }
+    else if (a.type == kind::array)
+    {
+        // array against bitmap: keep the array values the bitmap has, or lacks
+        for (std::uint16_t v : a.values)
+            if (test_bit(b.words, v) == (Op == bit_op::intersection_of)) result.values.push_back(v);
+        result.cardinality = static_cast<std::uint32_t>(result.values.size());
+    }
+    else if constexpr (Op == bit_op::intersection_of)
+    {
+        for (std::uint16_t v : b.values)
+            if (test_bit(a.words, v)) result.values.push_back(v);
+        result.cardinality = static_cast<std::uint32_t>(result.values.size());
+    }
+    else
+    {
+        // bitmap minus array
+        result = a;
+        for (std::uint16_t v : b.values)
+        {
+            std::uint64_t bit = std::uint64_t(1) << (v % 64);
+            result.cardinality -= (result.words[v / 64] & bit) != 0;
+            result.words[v / 64] &= ~bit;
+        }
+    }
+
+    if (result.type == kind::bitmap && result.cardinality <= array_limit) to_array(result);
+    else if (result.type == kind::array && result.cardinality > array_limit) to_bitmap(result);
+    return result;
+}
+
+template< class Key >
+template< typename roaring_set<Key>::bit_op Op >
+inline roaring_set<Key> roaring_set<Key>::combine( const roaring_set& a, const roaring_set& b )
+{
+    // merge the chunk lists by high half; a chunk on one side only is copied or dropped
+    roaring_set result;
+    size_t i = 0, j = 0;
+    auto keep = [&result]( chunk c ) {
+        if (c.cardinality == 0) return;
+        result.m_size += c.cardinality;
+        result.m_chunks.push_back(std::move(c));
+    };
+
+    while (i < a.m_chunks.size() && j < b.m_chunks.size())
+    {
+        const chunk& x = a.m_chunks[i];
+        const chunk& y = b.m_chunks[j];
+        if (x.high < y.high)
+        {
+            if constexpr (Op != bit_op::intersection_of) keep(x);
+            ++i;
+        }
+        else if (y.high < x.high)
+        {
+            if constexpr (Op == bit_op::union_of) keep(y);
+            ++j;
+        }
+        else
+        {
+            keep(combine_chunks<Op>(x, y));
+            ++i;
+            ++j;
+        }
+    }
+
+    if constexpr (Op != bit_op::intersection_of)
+        for (; i < a.m_chunks.size(); ++i) keep(a.m_chunks[i]);
+    if constexpr (Op == bit_op::union_of)
+        for (; j < b.m_chunks.size(); ++j) keep(b.m_chunks[j]);
+    return result;
+}
+
+template< class Key >
+inline roaring_set<Key>::size_type roaring_set<Key>::common_count( const roaring_set& other ) const
+{
+    size_type count = 0;
+    size_t i = 0, j = 0;
+    while (i < m_chunks.size() && j < other.m_chunks.size())
+    {
+        if (m_chunks[i].high < other.m_chunks[j].high) ++i;
+        else if (other.m_chunks[j].high < m_chunks[i].high) ++j;
+        else
+        {
+            const chunk& x = m_chunks[i++];
+            const chunk& y = other.m_chunks[j++];
+            if (x.type == kind::bitmap && y.type == kind::bitmap)
+                count += combine_bitmaps<bit_op::intersection_of, false>(x.words.data(), y.words.data(), nullptr);
+            else if (x.type == kind::array && y.type == kind::bitmap)
+                for (std::uint16_t v : x.values) count += test_bit(y.words, v);
+            else if (x.type == kind::bitmap && y.type == kind::array)
+                for (std::uint16_t v : y.values) count += test_bit(x.words, v);
+            else count += combine_chunks<bit_op::intersection_of>(x, y).cardinality;
+        }
+    }
+    return count;
+}
+
+#endif // !_ROARING_SET_HPP_
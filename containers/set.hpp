@@ -10,44 +10,141 @@
 #include <utility>
 #include <initializer_list>
 #include <cmath>
+#include <limits>
+#include <future>
+#include <thread>
+#include <optional>
+#include <type_traits>
+#include <vector>
 
 
-template< class Key >
-class set
+template< class Compare >
+concept transparent_compare = requires { typename Compare::is_transparent; };
+
+// allocators that can free everything they handed out at once, see pool_allocator
+template< class Alloc >
+concept releasable_allocator = requires( Alloc& alloc ) { { alloc.release_if_sole_owner() } -> std::same_as<bool>; };
+
+
+// Augmentation policies for set. A policy names the data kept in every node and
+// recomputes it from the node's key and its children's data (null for none)
+// whenever the tree changes below the node.
+struct no_augment
+{
+    struct data {};
+
+    template< class Key >
+    static data compute( const Key&, const data*, const data* ) { return {}; }
+};
+
+// subtree sizes: nth, rank and O(log n) distance between iterators
+struct order_statistics
+{
+    using data = size_t;
+
+    template< class Key >
+    static data compute( const Key&, const data* left, const data* right )
+    {
+        return 1 + (left ? *left : 0) + (right ? *right : 0);
+    }
+};
+
+// closed interval [lo, hi], ordered by lo and then hi
+template< class T >
+struct interval
+{
+    T lo;
+    T hi;
+
+    auto operator <=> ( const interval& ) const = default;
+};
+
+// subtree maxima of the hi endpoints: overlap and stabbing queries on a set of
+// intervals ordered by lo, which can skip every subtree ending before the query
+template< class T >
+struct interval_max
+{
+    using data = T;
+
+    template< class Key >
+    static data compute( const Key& key, const data* left, const data* right )
+    {
+        data highest = key.hi;
+        if (left && highest < *left) highest = *left;
+        if (right && highest < *right) highest = *right;
+        return highest;
+    }
+};
+
+template< class Augment >
+concept interval_augment = std::same_as<Augment, interval_max<typename Augment::data>>;
+
+
+template<
+    class Key,
+    class Compare = std::less<Key>,
+    class Allocator = std::allocator<Key>,
+    class Augment = no_augment
+> class set
 {
 private:
     class tree_iter;
+    class node_handle;
     struct base_node;
     struct avl_node;
 
+    // map keeps its entries in a set and links them with the descent below
+    template< class, class, class, class > friend class map;
+
 
 public:
     using key_type = Key;
     using value_type = Key;
     using size_type = size_t;
     using difference_type = std::ptrdiff_t;
-    using Compare = std::less<Key>;
+    using key_compare = Compare;
+    using value_compare = Compare;
+    using allocator_type = Allocator;
     using reference = Key&;
     using const_reference = const Key&;
-    using pointer = Key*;
-    using const_pointer = const Key*;
+    using pointer = std::allocator_traits<Allocator>::pointer;
+    using const_pointer = std::allocator_traits<Allocator>::const_pointer;
     using iterator = tree_iter;
     using const_iterator = const tree_iter;
+    using node_type = node_handle;
+
+    struct insert_return_type
+    {
+        iterator position;
+        bool inserted;
+        node_type node;
+    };
     
 
 public:
     // constructors and destructor
     set() : fake_node(nullptr), m_size(0ull) {}
+    explicit set( const Compare& comp, const Allocator& alloc = Allocator() )
+        : fake_node(nullptr), m_size(0ull), m_comp(comp), m_alloc(alloc) {}
+    explicit set( const Allocator& alloc ) : fake_node(nullptr), m_size(0ull), m_alloc(alloc) {}
+    template< std::input_iterator InputIt >
+    set( InputIt first, InputIt last, const Compare& comp = Compare(), const Allocator& alloc = Allocator() );
     template< std::input_iterator InputIt >
-    set( InputIt first, InputIt last);
+    set( InputIt first, InputIt last, const Allocator& alloc ) : set(first, last, Compare(), alloc) {}
     set( const set& other );
-    set( std::initializer_list<value_type> init );
+    set( const set& other, const Allocator& alloc );
+    set( set&& other ) noexcept : m_comp(other.m_comp), m_alloc(other.m_alloc) { take_tree(other); }
+    set( std::initializer_list<value_type> init, const Compare& comp = Compare(), const Allocator& alloc = Allocator() );
+    set( std::initializer_list<value_type> init, const Allocator& alloc ) : set(init, Compare(), alloc) {}
     ~set() { clear(); }
 
     // assignment operators
     set& operator=( const set& other );
+    set& operator=( set&& other );
     set& operator=( std::initializer_list<value_type> ilist );
 
+    allocator_type get_allocator() const noexcept { return m_alloc; }
+
     // iterators
     iterator begin();
     const_iterator begin() const;
@@ -59,19 +156,164 @@ public:
 
     // capacity
     bool empty() const noexcept { return m_size == 0ull; }
-    size_type size() const { std::distance(begin(), end()); }
+    size_type size() const noexcept { return m_size; }
 
     // modifiers
     void clear();
 
     std::pair<iterator, bool> insert( const value_type& key );
     std::pair<iterator, bool> insert( value_type&& key );
+    template< class... Args >
+    std::pair<iterator, bool> emplace( Args&&... args );
+
+    // start at hint, the position the key would go before, and fall back to a full
+    // descent only when the key does not belong next to it; O(1) amortized when right
+    iterator insert( const_iterator hint, const value_type& key );
+    iterator insert( const_iterator hint, value_type&& key );
+    template< class... Args >
+    iterator emplace_hint( const_iterator hint, Args&&... args );
 
     iterator erase( const_iterator pos );
+    size_type erase( const key_type& key ) { return erase_key(key); }
+    template< class K >
+        requires transparent_compare<Compare> && (!std::convertible_to<K, const_iterator>)
+    size_type erase( K&& key ) { return erase_key(key); }
+
+    // node handles own an unlinked node, so keys move between sets with equal
+    // allocators without being copied, freed or allocated again
+    node_type extract( const_iterator pos );
+    node_type extract( const key_type& key ) { return extract_key(key); }
+    template< class K >
+        requires transparent_compare<Compare> && (!std::convertible_to<K, const_iterator>)
+    node_type extract( K&& key ) { return extract_key(key); }
+
+    insert_return_type insert( node_type&& handle );
+    iterator insert( const_iterator hint, node_type&& handle );
+
+    // relinks every node of source whose key is not in this set yet
+    void merge( set& source );
+    void merge( set&& source ) { merge(source); }
+
+    // merges a batch in one pass over the tree in O(m log(n/m + 1)) for m keys
+    // into n rather than m descents: the batch is split around each node it
+    // reaches, a slice reaching an empty subtree is linked up as a balanced tree
+    // and joined, so each changed path is rebalanced once. A batch that is not
+    // strictly increasing is sorted first; keys already present are kept. Recurses
+    // on disjoint subtrees on up to max_threads threads when the allocator is
+    // stateless. Returns the number of keys inserted
+    template< std::input_iterator InputIt >
+    size_type insert_sorted_batch( InputIt first, InputIt last, unsigned max_threads = 1 );
+
+    // split moves every key not less than key into the returned set, join
+    // appends key and then right, whose keys must all be greater than key.
+    // Both relink O(log n) nodes. Join is O(log n); split is O(log n) with
+    // order_statistics, whose subtree counts give the sizes, and otherwise
+    // O(log n + min(k, n - k)) to count the smaller half of k and n - k keys
+    set split( const key_type& key );
+    void join( const key_type& key, set& right );
+    void join( set& right );
 
     // lookup
-    iterator find( const value_type& key );
-    const_iterator find( const value_type& key ) const;
+    iterator find( const key_type& key ) { return iterator(find_node(key)); }
+    const_iterator find( const key_type& key ) const { return const_iterator(find_node(key)); }
+    template< class K > requires transparent_compare<Compare>
+    iterator find( const K& key ) { return iterator(find_node(key)); }
+    template< class K > requires transparent_compare<Compare>
+    const_iterator find( const K& key ) const { return const_iterator(find_node(key)); }
+
+    bool contains( const key_type& key ) const { return find_node(key) != end_node(); }
+    template< class K > requires transparent_compare<Compare>
+    bool contains( const K& key ) const { return find_node(key) != end_node(); }
+
+    size_type count( const key_type& key ) const { return contains(key) ? 1 : 0; }
+    template< class K > requires transparent_compare<Compare>
+    size_type count( const K& key ) const { return contains(key) ? 1 : 0; }
+
+    iterator lower_bound( const key_type& key ) { return iterator(lower_bound_node(key)); }
+    const_iterator lower_bound( const key_type& key ) const { return const_iterator(lower_bound_node(key)); }
+    template< class K > requires transparent_compare<Compare>
+    iterator lower_bound( const K& key ) { return iterator(lower_bound_node(key)); }
+    template< class K > requires transparent_compare<Compare>
+    const_iterator lower_bound( const K& key ) const { return const_iterator(lower_bound_node(key)); }
+
+    iterator upper_bound( const key_type& key ) { return iterator(upper_bound_node(key)); }
+    const_iterator upper_bound( const key_type& key ) const { return const_iterator(upper_bound_node(key)); }
+    template< class K > requires transparent_compare<Compare>
+    iterator upper_bound( const K& key ) { return iterator(upper_bound_node(key)); }
+    template< class K > requires transparent_compare<Compare>
+    const_iterator upper_bound( const K& key ) const { return const_iterator(upper_bound_node(key)); }
+
+    std::pair<iterator, iterator> equal_range( const key_type& key ) { return equal_range_nodes<iterator>(key); }
+    std::pair<const_iterator, const_iterator> equal_range( const key_type& key ) const { return equal_range_nodes<const_iterator>(key); }
+    template< class K > requires transparent_compare<Compare>
+    std::pair<iterator, iterator> equal_range( const K& key ) { return equal_range_nodes<iterator>(key); }
+    template< class K > requires transparent_compare<Compare>
+    std::pair<const_iterator, const_iterator> equal_range( const K& key ) const { return equal_range_nodes<const_iterator>(key); }
+
+    // calls fn(key) in order for every key in [lo, hi), walking the tree once
+    // with an explicit stack instead of stepping iterators
+    template< class Fn >
+    void for_each_in_range( const key_type& lo, const key_type& hi, Fn fn ) const { scan_range(lo, hi, fn); }
+    template< class K, class Fn > requires transparent_compare<Compare>
+    void for_each_in_range( const K& lo, const K& hi, Fn fn ) const { scan_range(lo, hi, fn); }
+
+    // order statistics, O(log n)
+    iterator nth( size_type k ) requires std::same_as<Augment, order_statistics> { return iterator(nth_node(k)); }
+    const_iterator nth( size_type k ) const requires std::same_as<Augment, order_statistics> { return const_iterator(nth_node(k)); }
+    size_type rank( const key_type& key ) const requires std::same_as<Augment, order_statistics>;
+    size_type index_of( const_iterator pos ) const requires std::same_as<Augment, order_statistics> { return index_of_node(pos.m_node); }
+    difference_type distance( const_iterator first, const_iterator last ) const requires std::same_as<Augment, order_statistics>
+    {
+        return static_cast<difference_type>(index_of_node(last.m_node)) - static_cast<difference_type>(index_of_node(first.m_node));
+    }
+
+    // interval queries: fn(key) in order for every interval meeting [lo, hi], or
+    // holding point. O(log n) to the first, then O(log n) per reported interval
+    // at worst, since only subtrees ending at or after lo are entered
+    template< class Fn >
+    void for_each_overlapping( const typename Augment::data& lo, const typename Augment::data& hi, Fn fn ) const requires interval_augment<Augment>
+    {
+        scan_overlapping(lo, hi, fn);
+    }
+    template< class Fn >
+    void for_each_stabbing( const typename Augment::data& point, Fn fn ) const requires interval_augment<Augment> { scan_overlapping(point, point, fn); }
+    std::vector<Key> overlapping( const typename Augment::data& lo, const typename Augment::data& hi ) const requires interval_augment<Augment>
+    {
+        std::vector<Key> found;
+        for_each_overlapping(lo, hi, [&found]( const Key& key ) { found.push_back(key); });
+        return found;
+    }
+    std::vector<Key> stabbing( const typename Augment::data& point ) const requires interval_augment<Augment> { return overlapping(point, point); }
+
+    // observers
+    key_compare key_comp() const { return m_comp; }
+    value_compare value_comp() const { return m_comp; }
+
+    // join based set algebra in O(m log(n/m + 1)), recursing in parallel on up to
+    // max_threads threads when the allocator is stateless. The operands are consumed,
+    // pass them with std::move to avoid a copy; the result keeps a's comparator and allocator
+    friend set set_union( set a, set b, unsigned max_threads = std::thread::hardware_concurrency() )
+    {
+        size_type total = a.m_size + b.m_size;
+        size_type common = a.combine(b, &set::union_trees, max_threads);
+        a.m_size = total - common;
+        return a;
+    }
+
+    friend set set_intersection( set a, set b, unsigned max_threads = std::thread::hardware_concurrency() )
+    {
+        size_type common = a.combine(b, &set::intersect_trees, max_threads);
+        a.m_size = common;
+        return a;
+    }
+
+    friend set set_difference( set a, set b, unsigned max_threads = std::thread::hardware_concurrency() )
+    {
+        size_type total = a.m_size;
+        size_type common = a.combine(b, &set::difference_trees, max_threads);
+        a.m_size = total - common;
+        return a;
+    }
 
 
 private:
@@ -82,18 +324,17 @@ private:
         base_node* parent;
         char height;
 
-        base_node() : left(nullptr), right(nullptr), parent(nullptr), height(0) {}
-        base_node( base_node* p ) : left(nullptr), right(nullptr), parent(p), height(0) {}
+        base_node() : left(nullptr), right(nullptr), parent(nullptr), height(1) {}
+        base_node( base_node* p ) : left(nullptr), right(nullptr), parent(p), height(1) {}
     };
 
     struct avl_node : base_node
     {
         Key key;
-
-        avl_node(const Key& _key, base_node* p) : key(_key), base_node(p) {}
+        [[no_unique_address]] typename Augment::data aug{};
 
         template< class... Args >
-        avl_node(Args&&... args, base_node* p) : key(std::forward< Args >(args)...), base_node(p) {}
+        avl_node( base_node* p, Args&&... args ) : base_node(p), key(std::forward<Args>(args)...) {}
         friend class set;
     };
 
@@ -102,6 +343,7 @@ private:
     private:
         friend class set;
         friend struct base_node;
+        template< class, class, class, class > friend class map;
 
     public:
         using iterator_type = set::value_type;
@@ -119,6 +361,7 @@ private:
 
     public:
         tree_iter( const tree_iter& other ) : m_node( other.m_node ) {}
+        tree_iter& operator = ( const tree_iter& other ) = default;
 
         reference operator * () const noexcept { return static_cast<avl_node*>( m_node )->key; } 
         pointer operator -> () const noexcept { return &static_cast<avl_node*>( m_node )->key; }
@@ -126,118 +369,1030 @@ private:
         tree_iter& operator -- () { m_node = set::prev( m_node ); return *this; }
         tree_iter operator ++ (int) { tree_iter tmp = *this; ++(*this); return tmp; } 
         tree_iter operator -- (int) { tree_iter tmp = *this; --(*this); return tmp; } 
-        bool operator == ( const tree_iter& other ) { return m_node == other.m_node; }
-        bool operator != ( const tree_iter& other ) { return !(*this == other.m_node); }
+        bool operator == ( const tree_iter& other ) const { return m_node == other.m_node; }
+        bool operator != ( const tree_iter& other ) const { return m_node != other.m_node; }
+
+        // found by unqualified calls, std::distance itself always steps
+        friend difference_type distance( const tree_iter& first, const tree_iter& last ) requires std::same_as<Augment, order_statistics>
+        {
+            return static_cast<difference_type>(set::index_of_node(last.m_node)) - static_cast<difference_type>(set::index_of_node(first.m_node));
+        }
     };
 
-    base_node fake_node;
-    size_type m_size;
+    using node_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<avl_node>;
+    using node_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<avl_node>;
+
+    // owns one node taken out of a set together with the allocator that made it
+    class node_handle
+    {
+    private:
+        friend class set;
+
+        node_handle( avl_node* node, const node_allocator& alloc ) : m_node(node), m_alloc(alloc) {}
+
+        avl_node* m_node = nullptr;
+        std::optional<node_allocator> m_alloc;
+
+        avl_node* release() noexcept
+        {
+            m_alloc.reset();
+            return std::exchange(m_node, nullptr);
+        }
+
+    public:
+        using value_type = Key;
+        using allocator_type = Allocator;
+
+        constexpr node_handle() noexcept = default;
+        node_handle( node_handle&& other ) noexcept : m_node(std::exchange(other.m_node, nullptr)), m_alloc(std::move(other.m_alloc)) { other.m_alloc.reset(); }
+        node_handle& operator=( node_handle&& other ) noexcept
+        {
+            node_handle old(std::move(*this));
+            swap(other);
+            return *this;
+        }
+        ~node_handle()
+        {
+            if (m_node == nullptr) return;
+            node_allocator_traits::destroy(*m_alloc, m_node);
+            node_allocator_traits::deallocate(*m_alloc, m_node, 1);
+        }
+
+        [[nodiscard]] bool empty() const noexcept { return m_node == nullptr; }
+        explicit operator bool() const noexcept { return m_node != nullptr; }
+
+        // the key may be changed before the node goes into a set again
+        value_type& value() const { return m_node->key; }
+        allocator_type get_allocator() const { return allocator_type(*m_alloc); }
+
+        void swap( node_handle& other ) noexcept
+        {
+            std::swap(m_node, other.m_node);
+            std::swap(m_alloc, other.m_alloc);
+        }
+        friend void swap( node_handle& a, node_handle& b ) noexcept { a.swap(b); }
+    };
+
+    // header: left is the root, right the rightmost node, parent stays null
+    base_node fake_node;
+    base_node* m_leftmost = &fake_node;
+    size_type m_size = 0ull;
+    [[no_unique_address]] Compare m_comp;
+    node_allocator m_alloc;
+
+    base_node* end_node() const { return const_cast<base_node*>(&fake_node); }
+
+    // one comparison per level: descend to the first node not less than key
+    template< class K >
+    base_node* lower_bound_node( const K& key ) const
+    {
+        base_node* node = fake_node.left;
+        base_node* candidate = nullptr;
+        while (node != nullptr)
+        {
+            if (!m_comp(static_cast<avl_node*>(node)->key, key))
+            {
+                candidate = node;
+                node = node->left;
+            }
+            else node = node->right;
+        }
+        return candidate != nullptr ? candidate : end_node();
+    }
+
+    template< class K >
+    base_node* upper_bound_node( const K& key ) const
+    {
+        base_node* node = fake_node.left;
+        base_node* candidate = nullptr;
+        while (node != nullptr)
+        {
+            if (m_comp(key, static_cast<avl_node*>(node)->key))
+            {
+                candidate = node;
+                node = node->left;
+            }
+            else node = node->right;
+        }
+        return candidate != nullptr ? candidate : end_node();
+    }
+
+    // keys are unique, so the range is empty or the lower bound alone
+    template< class It, class K >
+    std::pair<It, It> equal_range_nodes( const K& key ) const
+    {
+        base_node* first = lower_bound_node(key);
+        if (first == end_node() || m_comp(key, static_cast<avl_node*>(first)->key)) return std::make_pair(It(first), It(first));
+        return std::make_pair(It(first), It(next(first)));
+    }
+
+    template< class K, class Fn >
+    void scan_range( const K& lo, const K& hi, Fn& fn ) const;
+    template< class Fn >
+    void scan_overlapping( const typename Augment::data& lo, const typename Augment::data& hi, Fn& fn ) const;
+
+    // where key would be linked, or the node already holding it
+    template< class K >
+    base_node* insert_position( const K& key, base_node*& parent, bool& left ) const;
+    template< class K >
+    base_node* hint_position( const_iterator hint, const K& key, base_node*& parent, bool& left ) const;
+    avl_node* link_node( avl_node* node, base_node* parent, bool left );
+    // takes node out of the tree without freeing it and returns its successor
+    base_node* unlink_node( base_node* node );
+
+    static void prefetch( const base_node* node )
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(node);
+#else
+        (void)node;
+#endif
+    }
+
+    template< class K >
+    base_node* find_node( const K& key ) const
+    {
+        base_node* node = lower_bound_node(key);
+        if (node == end_node() || m_comp(key, static_cast<avl_node*>(node)->key)) return end_node();
+        return node;
+    }
+
+    template< class K >
+    size_type erase_key( const K& key )
+    {
+        base_node* node = find_node(key);
+        if (node == end_node()) return 0;
+
+        erase(iterator(node));
+        return 1;
+    }
+
+    template< class K >
+    node_type extract_key( const K& key )
+    {
+        base_node* node = find_node(key);
+        if (node == end_node()) return node_type();
+
+        return extract(const_iterator(node));
+    }
+
+    template< class... Args >
+    avl_node* create_node( base_node* parent, Args&&... args )
+    {
+        avl_node* new_node = node_allocator_traits::allocate(m_alloc, 1);
+        try
+        {
+            node_allocator_traits::construct(m_alloc, new_node, parent, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            node_allocator_traits::deallocate(m_alloc, new_node, 1);
+            throw;
+        }
+        update_augment(new_node);
+        return new_node;
+    }
+
+    void destroy_node( base_node* node )
+    {
+        avl_node* old_node = static_cast<avl_node*>(node);
+        node_allocator_traits::destroy(m_alloc, old_node);
+        node_allocator_traits::deallocate(m_alloc, old_node, 1);
+    }
+
+    // bulk construction, all expect an empty tree
+    template< class InputIt >
+    void assign_range( InputIt first, InputIt last );
+    template< class ForwardIt >
+    base_node* build_sorted( ForwardIt& it, size_type count );
+    base_node* clone_tree( const base_node* node );
+    void attach_root( base_node* root, size_type count );
+    base_node* detach_root();
+    void take_tree( set& other );
+    base_node* take_nodes( set& other );
+
+    // split and join on detached subtrees, the parent link of a returned root is unspecified
+    template< class K >
+    base_node* split_tree( base_node* root, const K& key, base_node*& left, base_node*& right );
+    base_node* split_last( base_node* root, base_node*& last );
+    base_node* join_trees( base_node* left, base_node* mid, base_node* right );
+    base_node* join_trees( base_node* left, base_node* right );
+
+    // set algebra on detached trees, common counts the keys found in both
+    using tree_op = base_node* (set::*)( base_node*, base_node*, unsigned, size_type& );
+    static constexpr int parallel_grain_height = 12;
+
+    size_type combine( set& other, tree_op op, unsigned max_threads );
+    base_node* union_trees( base_node* a, base_node* b, unsigned depth, size_type& common );
+    base_node* intersect_trees( base_node* a, base_node* b, unsigned depth, size_type& common );
+    base_node* difference_trees( base_node* a, base_node* b, unsigned depth, size_type& common );
+
+    // batch insert of detached nodes sorted by key, see insert_sorted_batch
+    base_node* insert_nodes( base_node* root, base_node** first, base_node** last, unsigned depth, size_type& added );
+    base_node* insert_single( base_node* root, base_node* node, size_type& added );
+    base_node* link_sorted( base_node** first, size_type count );
+
+    template< class F, class G >
+    static void fork( bool parallel, F&& f, G&& g );
+
+    // healping methods for avl-tree
+    void destroy_tree( base_node* node );
+    void replace_child( base_node* parent, base_node* old_child, base_node* new_child );
+
+    char height( base_node* node );
+    void fix_height( base_node* node );
+
+    static constexpr bool augmented = !std::same_as<Augment, no_augment>;
+    static void update_augment( base_node* node );
+    static size_type subtree_size( const base_node* node );
+    static size_type index_of_node( const base_node* node );
+    base_node* nth_node( size_type k ) const;
+
+    int balance_factor( base_node* node );
+    void balance_tree( base_node* node );
+    base_node* left_rotate(  iterator it );
+    base_node* right_rotate( iterator it );
+
+    // for iteration
+    static base_node* next( base_node* node );
+    static base_node* prev( base_node* node );
+};
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< std::input_iterator InputIt >
+inline set<Key, Compare, Allocator, Augment>::set( InputIt first, InputIt last, const Compare& comp, const Allocator& alloc )
+    : m_comp(comp), m_alloc(alloc)
+{
+    assign_range(first, last);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::set( std::initializer_list<value_type> init, const Compare& comp, const Allocator& alloc )
+    : m_comp(comp), m_alloc(alloc)
+{
+    assign_range(init.begin(), init.end());
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::set( const set<Key, Compare, Allocator, Augment>& other )
+    : m_comp(other.m_comp), m_alloc(node_allocator_traits::select_on_container_copy_construction(other.m_alloc))
+{
+    attach_root(clone_tree(other.fake_node.left), other.m_size);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::set( const set<Key, Compare, Allocator, Augment>& other, const Allocator& alloc )
+    : m_comp(other.m_comp), m_alloc(alloc)
+{
+    attach_root(clone_tree(other.fake_node.left), other.m_size);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class InputIt >
+inline void set<Key, Compare, Allocator, Augment>::assign_range( InputIt first, InputIt last )
+{
+    auto not_less = [this]( const Key& a, const Key& b ) { return !m_comp(a, b); };
+
+    // strictly increasing input is linked up as it is
+    if constexpr (std::forward_iterator<InputIt>)
+    {
+        if (std::adjacent_find(first, last, not_less) == last)
+        {
+            InputIt it = first;
+            size_type count = static_cast<size_type>(std::distance(first, last));
+            attach_root(build_sorted(it, count), count);
+            return;
+        }
+    }
+
+    // anything else is staged and sorted, the first of equal keys wins as with insert
+    std::vector<Key> buffer(first, last);
+    std::stable_sort(buffer.begin(), buffer.end(), m_comp);
+    buffer.erase(std::unique(buffer.begin(), buffer.end(), not_less), buffer.end());
+
+    auto it = std::make_move_iterator(buffer.begin());
+    attach_root(build_sorted(it, buffer.size()), buffer.size());
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class ForwardIt >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::build_sorted( ForwardIt& it, size_type count )
+{
+    // in order: left half, middle key, right half; subtree sizes differ by at most one
+    if (count == 0) return nullptr;
+
+    base_node* left = build_sorted(it, count / 2);
+    base_node* node;
+    try
+    {
+        node = create_node(nullptr, *it);
+        ++it;
+    }
+    catch (...)
+    {
+        destroy_tree(left);
+        throw;
+    }
+
+    base_node* right;
+    try
+    {
+        right = build_sorted(it, count - count / 2 - 1);
+    }
+    catch (...)
+    {
+        destroy_tree(left);
+        destroy_node(node);
+        throw;
+    }
+
+    node->left = left;
+    node->right = right;
+    if (left != nullptr) left->parent = node;
+    if (right != nullptr) right->parent = node;
+    fix_height(node);
+
+    return node;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::clone_tree( const base_node* node )
+{
+    if (node == nullptr) return nullptr;
+
+    base_node* copy = create_node(nullptr, static_cast<const avl_node*>(node)->key);
+    try
+    {
+        copy->left = clone_tree(node->left);
+        copy->right = clone_tree(node->right);
+    }
+    catch (...)
+    {
+        destroy_tree(copy->left);
+        destroy_node(copy);
+        throw;
+    }
+
+    if (copy->left != nullptr) copy->left->parent = copy;
+    if (copy->right != nullptr) copy->right->parent = copy;
+    copy->height = node->height;
+    static_cast<avl_node*>(copy)->aug = static_cast<const avl_node*>(node)->aug;
+
+    return copy;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::attach_root( base_node* root, size_type count )
+{
+    m_size = count;
+    fake_node.left = root;
+    if (root == nullptr) return;
+
+    root->parent = &fake_node;
+
+    base_node* node = root;
+    while (node->left != nullptr) node = node->left;
+    m_leftmost = node;
+
+    node = root;
+    while (node->right != nullptr) node = node->right;
+    fake_node.right = node;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::detach_root()
+{
+    base_node* root = fake_node.left;
+    fake_node.left = nullptr;
+    fake_node.right = nullptr;
+    m_leftmost = &fake_node;
+    m_size = 0;
+    return root;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::take_tree( set& other )
+{
+    size_type count = other.m_size;
+    base_node* leftmost = other.m_leftmost;
+    base_node* rightmost = other.fake_node.right;
+    base_node* root = other.detach_root();
+
+    m_size = count;
+    fake_node.left = root;
+    if (root == nullptr) return;
+
+    root->parent = &fake_node;
+    m_leftmost = leftmost;
+    fake_node.right = rightmost;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::take_nodes( set& other )
+{
+    if (m_alloc == other.m_alloc) return other.detach_root();
+
+    // nodes must be freed by an equal allocator, move the keys into new ones
+    auto it = std::make_move_iterator(other.begin());
+    base_node* root = build_sorted(it, other.m_size);
+    other.clear();
+    return root;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class K >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::split_tree( base_node* root, const K& key, base_node*& left, base_node*& right )
+{
+    // returns the node equal to key, if any, detached from both halves
+    if (root == nullptr)
+    {
+        left = right = nullptr;
+        return nullptr;
+    }
+
+    base_node* root_left = root->left;
+    base_node* root_right = root->right;
+    base_node* middle;
+    base_node* part;
+
+    if (m_comp(key, static_cast<avl_node*>(root)->key))
+    {
+        middle = split_tree(root_left, key, left, part);
+        right = join_trees(part, root, root_right);
+    }
+    else if (m_comp(static_cast<avl_node*>(root)->key, key))
+    {
+        middle = split_tree(root_right, key, part, right);
+        left = join_trees(root_left, root, part);
+    }
+    else
+    {
+        left = root_left;
+        right = root_right;
+        middle = root;
+    }
+    return middle;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::split_last( base_node* root, base_node*& last )
+{
+    if (root->right == nullptr)
+    {
+        last = root;
+        return root->left;
+    }
+
+    base_node* rest = split_last(root->right, last);
+    return join_trees(root->left, root, rest);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::join_trees( base_node* left, base_node* mid, base_node* right )
+{
+    int left_height = height(left);
+    int right_height = height(right);
+
+    // hang mid on the spine of the taller tree where the heights meet, then
+    // rebalance upwards as after an insert; the local header stops balance_tree
+    if (left_height > right_height + 1)
+    {
+        base_node header;
+        header.left = left;
+        left->parent = &header;
+
+        base_node* parent = left;
+        while (height(parent->right) > right_height + 1) parent = parent->right;
+
+        mid->left = parent->right;
+        mid->right = right;
+        if (mid->left != nullptr) mid->left->parent = mid;
+        if (right != nullptr) right->parent = mid;
+        fix_height(mid);
+
+        parent->right = mid;
+        mid->parent = parent;
+        balance_tree(parent);
+
+        return header.left;
+    }
+
+    if (right_height > left_height + 1)
+    {
+        base_node header;
+        header.left = right;
+        right->parent = &header;
+
+        base_node* parent = right;
+        while (height(parent->left) > left_height + 1) parent = parent->left;
+
+        mid->right = parent->left;
+        mid->left = left;
+        if (mid->right != nullptr) mid->right->parent = mid;
+        if (left != nullptr) left->parent = mid;
+        fix_height(mid);
+
+        parent->left = mid;
+        mid->parent = parent;
+        balance_tree(parent);
+
+        return header.left;
+    }
+
+    mid->left = left;
+    mid->right = right;
+    if (left != nullptr) left->parent = mid;
+    if (right != nullptr) right->parent = mid;
+    fix_height(mid);
+
+    return mid;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::join_trees( base_node* left, base_node* right )
+{
+    if (left == nullptr) return right;
+    if (right == nullptr) return left;
+
+    base_node* last;
+    left = split_last(left, last);
+    return join_trees(left, last, right);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class F, class G >
+inline void set<Key, Compare, Allocator, Augment>::fork( bool parallel, F&& f, G&& g )
+{
+    if (!parallel)
+    {
+        f();
+        g();
+        return;
+    }
+
+    auto task = std::async(std::launch::async, std::forward<F>(f));
+    g();
+    task.get();
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::size_type set<Key, Compare, Allocator, Augment>::combine( set& other, tree_op op, unsigned max_threads )
+{
+    // stateful allocators (pool_allocator) are not thread safe, stay on one thread
+    unsigned depth = 0;
+    if constexpr (node_allocator_traits::is_always_equal::value)
+        while ((1u << depth) < max_threads) ++depth;
+
+    base_node* right = take_nodes(other);
+    base_node* left = detach_root();
+
+    size_type common = 0;
+    attach_root((this->*op)(left, right, depth, common), 0);
+    return common;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::union_trees( base_node* a, base_node* b, unsigned depth, size_type& common )
+{
+    if (a == nullptr) return b;
+    if (b == nullptr) return a;
+
+    base_node* b_left;
+    base_node* b_right;
+    if (base_node* twin = split_tree(b, static_cast<avl_node*>(a)->key, b_left, b_right))
+    {
+        destroy_node(twin);
+        ++common;
+    }
+
+    base_node* a_left = a->left;
+    base_node* a_right = a->right;
+    base_node* left;
+    base_node* right;
+    size_type left_common = 0, right_common = 0;
+    unsigned next_depth = depth > 0 ? depth - 1 : 0;
+
+    fork(depth > 0 && height(a) > parallel_grain_height,
+        [&] { left = union_trees(a_left, b_left, next_depth, left_common); },
+        [&] { right = union_trees(a_right, b_right, next_depth, right_common); });
+
+    common += left_common + right_common;
+    return join_trees(left, a, right);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::intersect_trees( base_node* a, base_node* b, unsigned depth, size_type& common )
+{
+    if (a == nullptr || b == nullptr)
+    {
+        destroy_tree(a);
+        destroy_tree(b);
+        return nullptr;
+    }
+
+    base_node* b_left;
+    base_node* b_right;
+    base_node* twin = split_tree(b, static_cast<avl_node*>(a)->key, b_left, b_right);
+
+    base_node* a_left = a->left;
+    base_node* a_right = a->right;
+    base_node* left;
+    base_node* right;
+    size_type left_common = 0, right_common = 0;
+    unsigned next_depth = depth > 0 ? depth - 1 : 0;
+
+    fork(depth > 0 && height(a) > parallel_grain_height,
+        [&] { left = intersect_trees(a_left, b_left, next_depth, left_common); },
+        [&] { right = intersect_trees(a_right, b_right, next_depth, right_common); });
+
+    common += left_common + right_common;
+    if (twin != nullptr)
+    {
+        destroy_node(twin);
+        ++common;
+        return join_trees(left, a, right);
+    }
+
+    destroy_node(a);
+    return join_trees(left, right);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::difference_trees( base_node* a, base_node* b, unsigned depth, size_type& common )
+{
+    if (a == nullptr)
+    {
+        destroy_tree(b);
+        return nullptr;
+    }
+    if (b == nullptr) return a;
+
+    // split a by b's root here, b is what gets discarded
+    base_node* a_left;
+    base_node* a_right;
+    base_node* twin = split_tree(a, static_cast<avl_node*>(b)->key, a_left, a_right);
+
+    base_node* b_left = b->left;
+    base_node* b_right = b->right;
+    base_node* left;
+    base_node* right;
+    size_type left_common = 0, right_common = 0;
+    unsigned next_depth = depth > 0 ? depth - 1 : 0;
+
+    fork(depth > 0 && height(b) > parallel_grain_height,
+        [&] { left = difference_trees(a_left, b_left, next_depth, left_common); },
+        [&] { right = difference_trees(a_right, b_right, next_depth, right_common); });
+
+    common += left_common + right_common;
+    destroy_node(b);
+    if (twin != nullptr)
+    {
+        destroy_node(twin);
+        ++common;
+    }
+
+    return join_trees(left, right);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::insert_nodes( base_node* root, base_node** first, base_node** last, unsigned depth, size_type& added )
+{
+    if (first == last) return root;
+    if (root == nullptr)
+    {
+        added += static_cast<size_type>(last - first);
+        return link_sorted(first, static_cast<size_type>(last - first));
+    }
+    if (last - first == 1) return insert_single(root, *first, added);
+
+    // a binary search on the batch in place of a split, a key already here is dropped
+    const Key& key = static_cast<avl_node*>(root)->key;
+    base_node** mid = std::partition_point(first, last, [&]( base_node* node ) { return m_comp(static_cast<avl_node*>(node)->key, key); });
+    base_node** after = mid;
+    if (mid != last && !m_comp(key, static_cast<avl_node*>(*mid)->key)) destroy_node(*after++);
+
+    base_node* root_left = root->left;
+    base_node* root_right = root->right;
+    int left_height = first != mid ? height(root_left) : 0;
+    int right_height = after != last ? height(root_right) : 0;
+    base_node* left;
+    base_node* right;
+    size_type left_added = 0, right_added = 0;
+    unsigned next_depth = depth > 0 ? depth - 1 : 0;
+
+    fork(depth > 0 && height(root) > parallel_grain_height,
+        [&] { left = insert_nodes(root_left, first, mid, next_depth, left_added); },
+        [&] { right = insert_nodes(root_right, after, last, next_depth, right_added); });
+
+    added += left_added + right_added;
+
+    // like balance_tree, stop rebalancing once subtree heights stay the same;
+    // only changed links are written, most visited nodes stay clean in cache
+    if ((first == mid || height(left) == left_height) && (after == last || height(right) == right_height))
+    {
+        if (left != root_left)
+        {
+            root->left = left;
+            left->parent = root;
+        }
+        if (right != root_right)
+        {
+            root->right = right;
+            right->parent = root;
+        }
+        update_augment(root);
+        return root;
+    }
+    return join_trees(left, root, right);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::insert_single( base_node* root, base_node* node, size_type& added )
+{
+    // most of a batch ends up alone in its subtree, where a plain descent and
+    // the usual bottom-up rebalance beat splitting it further
+    const Key& key = static_cast<avl_node*>(node)->key;
+    base_node* parent = root;
+    bool left;
+    while (true)
+    {
+        if (m_comp(key, static_cast<avl_node*>(parent)->key)) left = true;
+        else if (m_comp(static_cast<avl_node*>(parent)->key, key)) left = false;
+        else
+        {
+            destroy_node(node);
+            return root;
+        }
+
+        base_node* child = left ? parent->left : parent->right;
+        if (child == nullptr) break;
+        parent = child;
+    }
+
+    // a local header stops balance_tree at root, as in join_trees
+    base_node* above = root->parent;
+    base_node header;
+    header.left = root;
+    root->parent = &header;
+
+    update_augment(node);
+    node->parent = parent;
+    if (left) parent->left = node;
+    else parent->right = node;
+    balance_tree(parent);
+    ++added;
+
+    root = header.left;
+    root->parent = above;
+    return root;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::link_sorted( base_node** first, size_type count )
+{
+    // as build_sorted, on nodes that already exist
+    if (count == 0) return nullptr;
+
+    base_node* node = first[count / 2];
+    base_node* left = link_sorted(first, count / 2);
+    base_node* right = link_sorted(first + count / 2 + 1, count - count / 2 - 1);
+
+    node->left = left;
+    node->right = right;
+    if (left != nullptr) left->parent = node;
+    if (right != nullptr) right->parent = node;
+    fix_height(node);
+
+    return node;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class K, class Fn >
+inline void set<Key, Compare, Allocator, Augment>::scan_range( const K& lo, const K& hi, Fn& fn ) const
+{
+    // an AVL tree of height h never needs more than h pending nodes
+    base_node* stack[std::numeric_limits<char>::max()];
+    int top = 0;
+
+    // left spine of the keys not less than lo, subtrees entirely below lo are skipped
+    base_node* node = fake_node.left;
+    while (node != nullptr)
+    {
+        if (m_comp(static_cast<avl_node*>(node)->key, lo)) node = node->right;
+        else
+        {
+            stack[top++] = node;
+            node = node->left;
+        }
+        if (node != nullptr) prefetch(node);
+    }
+
+    while (top > 0)
+    {
+        node = stack[--top];
+        const Key& key = static_cast<avl_node*>(node)->key;
+        if (!m_comp(key, hi)) return;
+
+        // start fetching the next subtree before handing the key out
+        base_node* right = node->right;
+        if (right != nullptr) prefetch(right);
 
-    // healping methods for avl-tree
-    void recursive_clear( base_node* node );
+        fn(key);
 
-    char height( base_node* node );
-    void fix_height( base_node* node );
+        for (node = right; node != nullptr; node = node->left)
+        {
+            stack[top++] = node;
+            if (node->left != nullptr) prefetch(node->left);
+        }
+    }
+}
 
-    int balance_factor( base_node* node );
-    void balance_tree( base_node* node );
-    base_node* left_rotate(  iterator it );
-    base_node* right_rotate( iterator it );
+template< class Key, class Compare, class Allocator, class Augment >
+template< class Fn >
+inline void set<Key, Compare, Allocator, Augment>::scan_overlapping( const typename Augment::data& lo, const typename Augment::data& hi, Fn& fn ) const
+{
+    base_node* stack[std::numeric_limits<char>::max()];
+    int top = 0;
+
+    // in order over the subtrees whose highest endpoint reaches lo, the others
+    // hold no interval meeting [lo, hi]
+    auto push_left_spine = [&]( base_node* node ) {
+        for (; node != nullptr && !(static_cast<avl_node*>(node)->aug < lo); node = node->left)
+            stack[top++] = node;
+    };
 
-    // for iteration
-    static base_node* next( base_node* node );
-    static base_node* prev( base_node* node );
-};
+    push_left_spine(fake_node.left);
+    while (top > 0)
+    {
+        base_node* node = stack[--top];
+        const Key& key = static_cast<avl_node*>(node)->key;
 
-template< class Key >
-template< std::input_iterator InputIt >
-inline set<Key>::set( InputIt first, InputIt last )
+        // keys are ordered by lo, everything from here on starts after hi
+        if (hi < key.lo) return;
+        if (!(key.hi < lo)) fn(key);
+
+        push_left_spine(node->right);
+    }
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::destroy_tree( base_node* node )
 {
-    for (; first != last; ++first) insert(*first);
+    // rotate left children up until the node has none, then free it and go right:
+    // O(n) with no stack and no use of parent links, which detached subtrees lack
+    while (node != nullptr)
+    {
+        if (base_node* left = node->left)
+        {
+            node->left = left->right;
+            left->right = node;
+            node = left;
+        }
+        else
+        {
+            base_node* right = node->right;
+            destroy_node(node);
+            node = right;
+        }
+    }
 }
 
-template< class Key >
-inline set<Key>::set( std::initializer_list<value_type> init )
+template< class Key, class Compare, class Allocator, class Augment >
+inline char set<Key, Compare, Allocator, Augment>::height( base_node* node )
 {
-    for (const auto& k : init) insert(k);
+    return node ? node->height : 0;
 }
 
-template< class Key >
-inline set<Key>::set( const set<Key>& other )
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::fix_height( base_node* node )
 {
-    for (auto it = other.begin(); it != other.end; ++it) insert(*it);
+    char hl = height(node->left);
+    char hr = height(node->right);
+    
+    node->height = (hl > hr? hl : hr) + 1;
+    update_augment(node);
 }
 
-template< class Key >
-inline void set<Key>::recursive_clear( base_node* node )
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::update_augment( base_node* node )
 {
-    if ( node != nullptr )
+    if constexpr (augmented)
     {
-        recursive_clear(node->left);
-        recursive_clear(node->right);
-        delete node;
+        auto data = []( const base_node* child ) { return child ? &static_cast<const avl_node*>(child)->aug : nullptr; };
+
+        avl_node* augmented_node = static_cast<avl_node*>(node);
+        augmented_node->aug = Augment::compute(augmented_node->key, data(node->left), data(node->right));
     }
+}
 
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::size_type set<Key, Compare, Allocator, Augment>::subtree_size( const base_node* node )
+{
+    return node ? static_cast<const avl_node*>(node)->aug : 0;
 }
 
-template< class Key >
-inline char set<Key>::height( base_node* node )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::size_type set<Key, Compare, Allocator, Augment>::index_of_node( const base_node* node )
 {
-    return node ? node->height : 0;
+    // the header's left subtree is the whole tree, so end() maps to size()
+    size_type index = subtree_size(node->left);
+    if (node->parent == nullptr) return index;
+
+    for (const base_node* parent = node->parent; parent->parent != nullptr; node = parent, parent = parent->parent)
+        if (node == parent->right) index += subtree_size(parent->left) + 1;
+
+    return index;
 }
 
-template< class Key >
-inline void set<Key>::fix_height( base_node* node )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::nth_node( size_type k ) const
 {
-    char hl = height(node->left);
-    char hr = height(node->right);
-    
-    node->height = (hl > hr? hl : hr) + 1;
+    base_node* node = fake_node.left;
+    while (node != nullptr)
+    {
+        size_type left_size = subtree_size(node->left);
+        if (k < left_size) node = node->left;
+        else if (k == left_size) return node;
+        else
+        {
+            k -= left_size + 1;
+            node = node->right;
+        }
+    }
+    return end_node();
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::size_type set<Key, Compare, Allocator, Augment>::rank( const key_type& key ) const requires std::same_as<Augment, order_statistics>
+{
+    // number of keys less than key
+    size_type less = 0;
+    base_node* node = fake_node.left;
+    while (node != nullptr)
+    {
+        if (m_comp(static_cast<avl_node*>(node)->key, key))
+        {
+            less += subtree_size(node->left) + 1;
+            node = node->right;
+        }
+        else node = node->left;
+    }
+    return less;
 }
 
-template< class Key >
-inline int set<Key>::balance_factor( base_node* node )
+template< class Key, class Compare, class Allocator, class Augment >
+inline int set<Key, Compare, Allocator, Augment>::balance_factor( base_node* node )
 {
     return static_cast<int>(height(node->right)) - static_cast<int>(height(node->left));
 }
 
-template< class Key >
-inline void set<Key>::balance_tree( base_node* node )
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::balance_tree( base_node* node )
 {
-    while (node != &fake_node)
+    // walk up to the header, the only node without a parent
+    while (node->parent != nullptr)
     {   
         int left_height = height(node->left);
         int right_height = height(node->right);
-        int p_height = std::max(left_height, right_height) + 1;
+        int old_height = node->height;
         int balance = left_height - right_height;
 
-        if (p_height != node->height) node->height = p_height;
         if (balance == 2)
         {
-            if (height(node->left->left) >= height(node->left->right)) right_rotate(node);
+            if (height(node->left->left) >= height(node->left->right)) node = right_rotate(node);
             else 
             {
                 left_rotate(node->left);
-                right_rotate(node);
+                node = right_rotate(node);
             }
         }
 
         else if (balance == -2)
         {
-            if (height(node->right->right) >= height(node->right->left)) left_rotate(node);
+            if (height(node->right->right) >= height(node->right->left)) node = left_rotate(node);
             else 
             {
                 right_rotate(node->right);
-                left_rotate(node);
+                node = left_rotate(node);
             }
         }
 
+        else fix_height(node);
+
+        // ancestors only change shape if the height of this subtree did,
+        // their augmented data still needs refreshing
+        if (node->height == old_height)
+        {
+            if constexpr (augmented)
+                for (node = node->parent; node->parent != nullptr; node = node->parent) update_augment(node);
+            break;
+        }
         node = node->parent;
     }
 }
 
-template< class Key >
-inline set<Key>::base_node* set<Key>::left_rotate( set<Key>::iterator it )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::left_rotate( set<Key, Compare, Allocator, Augment>::iterator it )
 {
     base_node* node = it.m_node;
     base_node* right_node = node->right;
@@ -260,8 +1415,8 @@ inline set<Key>::base_node* set<Key>::left_rotate( set<Key>::iterator it )
     return right_node;
 }
 
-template< class Key >
-inline set<Key>::base_node* set<Key>::right_rotate( set<Key>::iterator it )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::right_rotate( set<Key, Compare, Allocator, Augment>::iterator it )
 {
     base_node* node = it.m_node;
     base_node* left_node = node->left;
@@ -284,8 +1439,8 @@ inline set<Key>::base_node* set<Key>::right_rotate( set<Key>::iterator it )
     return left_node;
 }
 
-template< class Key >
-inline set<Key>::base_node* set<Key>::next( base_node* node )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::next( base_node* node )
 {
     if (node->right != nullptr) 
     {
@@ -297,8 +1452,9 @@ inline set<Key>::base_node* set<Key>::next( base_node* node )
 
     else 
     {
+        // stop at the header, its right link is the rightmost node
         base_node* parent_node = node->parent;
-        while (parent_node != nullptr && node == parent_node->right) 
+        while (parent_node->parent != nullptr && node == parent_node->right) 
         {
             node = parent_node;
             parent_node = parent_node->parent;
@@ -307,9 +1463,12 @@ inline set<Key>::base_node* set<Key>::next( base_node* node )
     }
 }
 
-template< class Key >
-inline set<Key>::base_node* set<Key>::prev( base_node* node )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::prev( base_node* node )
 {
+    // --end()
+    if (node->parent == nullptr) return node->right;
+
     if (node->left != nullptr)
     {
         node = node->left;
@@ -321,7 +1480,7 @@ inline set<Key>::base_node* set<Key>::prev( base_node* node )
     else 
     {
         base_node* parent_node = node->parent;
-        while (parent_node != nullptr && node == parent_node->left) 
+        while (parent_node->parent != nullptr && node == parent_node->left) 
         {
             node = parent_node;
             parent_node = parent_node->parent;
@@ -330,226 +1489,574 @@ inline set<Key>::base_node* set<Key>::prev( base_node* node )
     }
 }
 
-template< class Key >
-inline set<Key>::iterator set<Key>::begin()
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::iterator set<Key, Compare, Allocator, Augment>::begin()
 {
-    if (fake_node.left == nullptr) return end();
-    
-    base_node* node = fake_node.left;
-    while (node->left != nullptr) node = node->left;
-    return iterator(node);
+    return iterator(m_leftmost);
 }
 
-template< class Key >
-inline set<Key>::const_iterator set<Key>::begin() const
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::const_iterator set<Key, Compare, Allocator, Augment>::begin() const
 {
-    if (fake_node.left == nullptr) return end();
-    
-    base_node* node = fake_node.left;
-    while (node->left != nullptr) node = node->left;
-    return const_iterator(node);
+    return const_iterator(m_leftmost);
 }
 
-template< class Key >
-inline set<Key>::const_iterator set<Key>::cbegin() const noexcept
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::const_iterator set<Key, Compare, Allocator, Augment>::cbegin() const noexcept
 {
-    if (fake_node.left == nullptr) return cend();
-    
-    base_node* node = fake_node.left;
-    while (node->left != nullptr) node = node->left;
-    return const_iterator(node);
+    return const_iterator(m_leftmost);
 }
 
 
-template< class Key >
-inline set<Key>::iterator set<Key>::end()
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::iterator set<Key, Compare, Allocator, Augment>::end()
 {
-    if (fake_node.left == nullptr) return iterator(nullptr);
-    
-    base_node* node = fake_node.left;
-    while (node->right != nullptr) node = node->right;
-    return iterator(next(node));
+    return iterator(&fake_node);
 }
 
-template< class Key >
-inline set<Key>::const_iterator set<Key>::end() const
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::const_iterator set<Key, Compare, Allocator, Augment>::end() const
 {
-    if (fake_node.left == nullptr) return iterator(nullptr);
-    
-    base_node* node = fake_node.left;
-    while (node->right != nullptr) node = node->right;
-    return const_iterator(next(node));
+    return const_iterator(end_node());
 }
 
-template< class Key >
-inline set<Key>::const_iterator set<Key>::cend() const noexcept
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::const_iterator set<Key, Compare, Allocator, Augment>::cend() const noexcept
 {
-    if (fake_node.left == nullptr) return iterator(nullptr);
-    
-    base_node* node = fake_node.left;
-    while (node->right != nullptr) node = node->right;
-    return const_iterator(next(node));
+    return const_iterator(end_node());
 }
 
-template< class Key >
-inline void set<Key>::clear()
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::clear()
 {
-    recursive_clear(fake_node.left);
-    fake_node.left = nullptr;
-    m_size = 0;
-}
+    base_node* root = detach_root();
+    if (root == nullptr) return;
 
-template< class Key >
-inline std::pair<typename set<Key>::iterator, bool> set<Key>::insert( const set<Key>::value_type& key )
-{
-    if (fake_node.left == nullptr)
+    // a pool only this set draws from is dropped whole when no node needs destroying
+    if constexpr (std::is_trivially_destructible_v<avl_node> && releasable_allocator<node_allocator>)
     {
-        fake_node.left = new avl_node(key, &fake_node);
-        ++m_size;
-        return std::make_pair(iterator(fake_node.left), true);
+        if (m_alloc.release_if_sole_owner()) return;
     }
+    destroy_tree(root);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class K >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::insert_position( const K& key, base_node*& parent, bool& left ) const
+{
+    parent = end_node();
+    left = true;
 
     base_node* node = fake_node.left;
-    while (true)
+    while (node != nullptr)
     {
-        if (key < static_cast<avl_node*>(node)->key)
+        parent = node;
+        if (m_comp(key, static_cast<avl_node*>(node)->key))
         {
-            if (node->left == nullptr)
-            {
-                node->left = new avl_node(key, node);
-                ++m_size;
-                balance_tree(node);
-                return std::make_pair(iterator(node->left), true);
-            }
+            left = true;
             node = node->left;
         }
-
-        else if (static_cast<avl_node*>(node)->key < key)
+        else if (m_comp(static_cast<avl_node*>(node)->key, key))
         {
-            if (node->right == nullptr)
-            {
-                node->right = new avl_node(key, node);
-                ++m_size;
-                balance_tree(node);
-                return std::make_pair(iterator(node->right), true);
-            }
+            left = false;
             node = node->right;
         }
-        else return std::make_pair(iterator(node), false);
+        else return node;
     }
-
+    return nullptr;
 }
 
-template< class Key >
-inline std::pair<typename set<Key>::iterator, bool> set<Key>::insert( set<Key>::value_type&& key )
+template< class Key, class Compare, class Allocator, class Augment >
+template< class K >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::hint_position( const_iterator hint, const K& key, base_node*& parent, bool& left ) const
 {
-    if (fake_node.left == nullptr)
+    base_node* pos = hint.m_node;
+
+    // ascending streams hint end() and land right of the cached rightmost node
+    if (pos == end_node())
     {
-        fake_node.left = new avl_node(std::move(key), &fake_node);
-        ++m_size;
-        return std::make_pair(iterator(fake_node.left), true);
+        if (m_size > 0 && m_comp(static_cast<avl_node*>(fake_node.right)->key, key))
+        {
+            parent = fake_node.right;
+            left = false;
+            return nullptr;
+        }
+        return insert_position(key, parent, left);
     }
 
-    base_node* node = fake_node.left;
-    while (true)
+    // key between prev(hint) and hint: one of the two has a free slot facing the other
+    if (m_comp(key, static_cast<avl_node*>(pos)->key))
     {
-        if (key < static_cast<avl_node*>(node)->key)
+        if (pos == m_leftmost)
         {
-            if (node->left == nullptr)
-            {
-                node->left = new avl_node(std::move(key), node);
-                ++m_size;
-                balance_tree(node);
-                return std::make_pair(iterator(node->left), true);
-            }
-            node = node->left;
+            parent = pos;
+            left = true;
+            return nullptr;
         }
 
-        else if (static_cast<avl_node*>(node)->key < key)
+        base_node* before = prev(pos);
+        if (!m_comp(static_cast<avl_node*>(before)->key, key)) return insert_position(key, parent, left);
+
+        if (before->right == nullptr)
         {
-            if (node->right == nullptr)
-            {
-                node->right = new avl_node(std::move(key), node);
-                ++m_size;
-                balance_tree(node);
-                return std::make_pair(iterator(node->right), true);
-            }
-            node = node->right;
+            parent = before;
+            left = false;
+        }
+        else
+        {
+            parent = pos;
+            left = true;
+        }
+        return nullptr;
+    }
+
+    if (m_comp(static_cast<avl_node*>(pos)->key, key))
+    {
+        if (pos == fake_node.right)
+        {
+            parent = pos;
+            left = false;
+            return nullptr;
         }
-        else return std::make_pair(iterator(node), false);
+
+        base_node* after = next(pos);
+        if (!m_comp(key, static_cast<avl_node*>(after)->key)) return insert_position(key, parent, left);
+
+        if (pos->right == nullptr)
+        {
+            parent = pos;
+            left = false;
+        }
+        else
+        {
+            parent = after;
+            left = true;
+        }
+        return nullptr;
+    }
+
+    return pos;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::avl_node* set<Key, Compare, Allocator, Augment>::link_node( avl_node* node, base_node* parent, bool left )
+{
+    // extracted nodes still carry their old links
+    node->left = node->right = nullptr;
+    node->height = 1;
+    update_augment(node);
+
+    node->parent = parent;
+    if (parent == &fake_node)
+    {
+        fake_node.left = node;
+        fake_node.right = m_leftmost = node;
+    }
+    else if (left)
+    {
+        parent->left = node;
+        if (parent == m_leftmost) m_leftmost = node;
+    }
+    else
+    {
+        parent->right = node;
+        if (parent == fake_node.right) fake_node.right = node;
     }
 
+    ++m_size;
+    balance_tree(parent);
+    return node;
 }
 
-template< class Key >
-inline set<Key>::iterator set<Key>::erase(const_iterator pos)
+template< class Key, class Compare, class Allocator, class Augment >
+inline std::pair<typename set<Key, Compare, Allocator, Augment>::iterator, bool> set<Key, Compare, Allocator, Augment>::insert( const set<Key, Compare, Allocator, Augment>::value_type& key )
 {
-    avl_node* node = static_cast<avl_node*>(pos.m_node);
-    if (node == nullptr) return end();
+    base_node* parent;
+    bool left;
+    if (base_node* existing = insert_position(key, parent, left)) return std::make_pair(iterator(existing), false);
 
-    base_node* to_delete = nullptr;
-    if (node->left == nullptr || node->right == nullptr) to_delete = node;
+    return std::make_pair(iterator(link_node(create_node(parent, key), parent, left)), true);
+}
 
-    else 
+template< class Key, class Compare, class Allocator, class Augment >
+inline std::pair<typename set<Key, Compare, Allocator, Augment>::iterator, bool> set<Key, Compare, Allocator, Augment>::insert( set<Key, Compare, Allocator, Augment>::value_type&& key )
+{
+    base_node* parent;
+    bool left;
+    if (base_node* existing = insert_position(key, parent, left)) return std::make_pair(iterator(existing), false);
+
+    return std::make_pair(iterator(link_node(create_node(parent, std::move(key)), parent, left)), true);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class... Args >
+inline std::pair<typename set<Key, Compare, Allocator, Augment>::iterator, bool> set<Key, Compare, Allocator, Augment>::emplace( Args&&... args )
+{
+    // the key only exists once its node is built, a duplicate node is thrown away
+    avl_node* node = create_node(nullptr, std::forward<Args>(args)...);
+    base_node* parent;
+    bool left;
+    base_node* existing;
+    try
+    {
+        existing = insert_position(node->key, parent, left);
+    }
+    catch (...)
+    {
+        destroy_node(node);
+        throw;
+    }
+
+    if (existing != nullptr)
+    {
+        destroy_node(node);
+        return std::make_pair(iterator(existing), false);
+    }
+    return std::make_pair(iterator(link_node(node, parent, left)), true);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::iterator set<Key, Compare, Allocator, Augment>::insert( const_iterator hint, const value_type& key )
+{
+    base_node* parent;
+    bool left;
+    if (base_node* existing = hint_position(hint, key, parent, left)) return iterator(existing);
+
+    return iterator(link_node(create_node(parent, key), parent, left));
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::iterator set<Key, Compare, Allocator, Augment>::insert( const_iterator hint, value_type&& key )
+{
+    base_node* parent;
+    bool left;
+    if (base_node* existing = hint_position(hint, key, parent, left)) return iterator(existing);
+
+    return iterator(link_node(create_node(parent, std::move(key)), parent, left));
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< class... Args >
+inline set<Key, Compare, Allocator, Augment>::iterator set<Key, Compare, Allocator, Augment>::emplace_hint( const_iterator hint, Args&&... args )
+{
+    avl_node* node = create_node(nullptr, std::forward<Args>(args)...);
+    base_node* parent;
+    bool left;
+    base_node* existing;
+    try
+    {
+        existing = hint_position(hint, node->key, parent, left);
+    }
+    catch (...)
     {
-        to_delete = next(node);
-        node->key = static_cast<avl_node*>(to_delete)->key;
+        destroy_node(node);
+        throw;
     }
 
-    base_node* child = (to_delete->left != nullptr) ? to_delete->left : to_delete->right;
+    if (existing != nullptr)
+    {
+        destroy_node(node);
+        return iterator(existing);
+    }
+    return iterator(link_node(node, parent, left));
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::replace_child( base_node* parent, base_node* old_child, base_node* new_child )
+{
+    // the header keeps the root on its left, so test left first
+    if (parent->left == old_child) parent->left = new_child;
+    else parent->right = new_child;
+
+    if (new_child != nullptr) new_child->parent = parent;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::iterator set<Key, Compare, Allocator, Augment>::erase(const_iterator pos)
+{
+    base_node* node = pos.m_node;
+    if (node == &fake_node) return end();
+
+    base_node* successor = unlink_node(node);
+    destroy_node(node);
+    return iterator(successor);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::base_node* set<Key, Compare, Allocator, Augment>::unlink_node( base_node* node )
+{
+    base_node* successor = next(node);
+    if (node == m_leftmost) m_leftmost = successor;
+    if (node == fake_node.right) fake_node.right = m_size == 1 ? nullptr : prev(node);
+
+    // relink instead of copying keys, iterators to other elements stay valid
+    base_node* p_balance;
+    if (node->left != nullptr && node->right != nullptr)
+    {
+        if (successor->parent == node) p_balance = successor;
+        else
+        {
+            p_balance = successor->parent;
+            replace_child(successor->parent, successor, successor->right);
+            successor->right = node->right;
+            node->right->parent = successor;
+        }
+
+        successor->left = node->left;
+        node->left->parent = successor;
+        successor->height = node->height;
+        replace_child(node->parent, node, successor);
+    }
 
-    if (child != nullptr) child->parent = to_delete->parent;
-    if(to_delete->parent == nullptr) fake_node.left = child;
-    else if (to_delete == to_delete->parent->left) to_delete->parent->left = child;
-    else to_delete->parent->right = child;
+    else
+    {
+        p_balance = node->parent;
+        replace_child(node->parent, node, node->left != nullptr ? node->left : node->right);
+    }
 
-    base_node* p_balance = to_delete->parent;
-    delete to_delete;
     --m_size;
+    balance_tree(p_balance);
+    return successor;
+}
 
-    if (p_balance != nullptr) balance_tree(p_balance);
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::node_type set<Key, Compare, Allocator, Augment>::extract( const_iterator pos )
+{
+    base_node* node = pos.m_node;
+    if (node == &fake_node) return node_type();
 
-    return iterator(p_balance);
+    unlink_node(node);
+    return node_type(static_cast<avl_node*>(node), m_alloc);
 }
 
-template< class Key >
-inline set<Key>::iterator set<Key>::find(const Key& key) 
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::insert_return_type set<Key, Compare, Allocator, Augment>::insert( node_type&& handle )
 {
-    base_node* node = fake_node.left;
-    while (node != nullptr)
+    if (handle.empty()) return insert_return_type{ end(), false, node_type() };
+
+    base_node* parent;
+    bool left;
+    if (base_node* existing = insert_position(handle.value(), parent, left))
+        return insert_return_type{ iterator(existing), false, std::move(handle) };
+
+    // a node from an unequal allocator cannot be freed by ours, its key moves
+    // instead and the emptied node goes back through the handle's allocator
+    if (!(*handle.m_alloc == m_alloc))
+    {
+        iterator it(link_node(create_node(parent, std::move(handle.value())), parent, left));
+        handle = node_type();
+        return insert_return_type{ it, true, node_type() };
+    }
+
+    return insert_return_type{ iterator(link_node(handle.release(), parent, left)), true, node_type() };
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>::iterator set<Key, Compare, Allocator, Augment>::insert( const_iterator hint, node_type&& handle )
+{
+    if (handle.empty()) return end();
+
+    base_node* parent;
+    bool left;
+    if (base_node* existing = hint_position(hint, handle.value(), parent, left)) return iterator(existing);
+
+    if (!(*handle.m_alloc == m_alloc))
     {
-        if (key < static_cast<avl_node*>(node)->key) node = node->left;
-        else if (key > static_cast<avl_node*>(node)->key) node = node->right;
-        else return iterator(node);
+        iterator it(link_node(create_node(parent, std::move(handle.value())), parent, left));
+        handle = node_type();
+        return it;
     }
-    return end();
+
+    return iterator(link_node(handle.release(), parent, left));
 }
 
-template< class Key >
-inline set<Key>::const_iterator set<Key>::find(const Key& key) const 
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::merge( set& source )
 {
-    base_node* node = fake_node.left;
-    while (node != nullptr)
+    if (&source == this) return;
+
+    // source runs in ascending order, so the node after the last one linked is
+    // the hint for the next and an interleaving merge stays O(1) per node
+    const bool relink = m_alloc == source.m_alloc;
+    base_node* hint = end_node();
+    base_node* node = source.m_leftmost;
+    while (node != source.end_node())
+    {
+        avl_node* moving = static_cast<avl_node*>(node);
+        base_node* parent;
+        bool left;
+        if (base_node* existing = hint_position(const_iterator(hint), moving->key, parent, left))
+        {
+            hint = next(existing);
+            node = next(node);
+            continue;
+        }
+
+        avl_node* linked;
+        if (relink)
+        {
+            node = source.unlink_node(node);
+            linked = link_node(moving, parent, left);
+        }
+        else
+        {
+            linked = link_node(create_node(parent, std::move(moving->key)), parent, left);
+            node = source.unlink_node(node);
+            source.destroy_node(moving);
+        }
+        hint = next(linked);
+    }
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+template< std::input_iterator InputIt >
+inline set<Key, Compare, Allocator, Augment>::size_type set<Key, Compare, Allocator, Augment>::insert_sorted_batch( InputIt first, InputIt last, unsigned max_threads )
+{
+    // every node is made before the tree is touched, a throwing copy leaves it as it was
+    std::vector<base_node*> nodes;
+    try
+    {
+        if constexpr (std::forward_iterator<InputIt>) nodes.reserve(static_cast<size_t>(std::distance(first, last)));
+        for (; first != last; ++first) nodes.push_back(create_node(nullptr, *first));
+    }
+    catch (...)
+    {
+        for (base_node* node : nodes) destroy_node(node);
+        throw;
+    }
+
+    auto less = [this]( base_node* a, base_node* b ) { return m_comp(static_cast<avl_node*>(a)->key, static_cast<avl_node*>(b)->key); };
+    auto not_less = [&less]( base_node* a, base_node* b ) { return !less(a, b); };
+
+    // anything else is sorted, the first of equal keys wins as with insert
+    if (std::adjacent_find(nodes.begin(), nodes.end(), not_less) != nodes.end())
+    {
+        std::stable_sort(nodes.begin(), nodes.end(), less);
+
+        size_t kept = 0;
+        for (base_node* node : nodes)
+        {
+            if (kept > 0 && !less(nodes[kept - 1], node)) destroy_node(node);
+            else nodes[kept++] = node;
+        }
+        nodes.resize(kept);
+    }
+    if (nodes.empty()) return 0;
+
+    // stateful allocators (pool_allocator) are not thread safe, stay on one thread
+    unsigned depth = 0;
+    if constexpr (node_allocator_traits::is_always_equal::value)
+        while ((1u << depth) < max_threads) ++depth;
+
+    size_type size = m_size;
+    size_type added = 0;
+    base_node* root = insert_nodes(detach_root(), nodes.data(), nodes.data() + nodes.size(), depth, added);
+    attach_root(root, size + added);
+    return added;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment> set<Key, Compare, Allocator, Augment>::split( const key_type& key )
+{
+    set greater(m_comp, get_allocator());
+    size_type total = m_size;
+
+    base_node* less;
+    base_node* rest;
+    if (base_node* equal = split_tree(detach_root(), key, less, rest)) rest = join_trees(nullptr, equal, rest);
+
+    attach_root(less, 0);
+    greater.attach_root(rest, 0);
+
+    if constexpr (std::same_as<Augment, order_statistics>) m_size = subtree_size(less);
+    else
+    {
+        // no subtree sizes are kept, count whichever half runs out first
+        size_type steps = 0;
+        auto left_it = begin();
+        auto right_it = greater.begin();
+        while (left_it != end() && right_it != greater.end())
+        {
+            ++left_it;
+            ++right_it;
+            ++steps;
+        }
+        m_size = left_it == end() ? steps : total - steps;
+    }
+    greater.m_size = total - m_size;
+    return greater;
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::join( const key_type& key, set& right )
+{
+    size_type total = m_size + 1 + right.m_size;
+    base_node* mid = create_node(nullptr, key);
+    base_node* rest;
+    try
     {
-        if (key < static_cast<avl_node*>(node)->key) node = node->left;
-        else if (key > static_cast<avl_node*>(node)->key) node = node->right;
-        else return const_iterator(node);
+        rest = take_nodes(right);
     }
-    return cend();
+    catch (...)
+    {
+        destroy_node(mid);
+        throw;
+    }
+
+    attach_root(join_trees(detach_root(), mid, rest), total);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline void set<Key, Compare, Allocator, Augment>::join( set& right )
+{
+    size_type total = m_size + right.m_size;
+    base_node* rest = take_nodes(right);
+    attach_root(join_trees(detach_root(), rest), total);
+}
+
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>& set<Key, Compare, Allocator, Augment>::operator=( const set& other )
+{
+    if (this == &other) return *this;
+
+    clear();
+    if constexpr (node_allocator_traits::propagate_on_container_copy_assignment::value) m_alloc = other.m_alloc;
+    m_comp = other.m_comp;
+
+    attach_root(clone_tree(other.fake_node.left), other.m_size);
+    return *this;
 }
 
-template< class Key >
-inline set<Key>& set<Key>::operator=( const set& other )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>& set<Key, Compare, Allocator, Augment>::operator=( set&& other )
 {
-    for (auto it = other.begin(); it != other.end(); ++it) insert(*it);
+    if (this == &other) return *this;
+
+    clear();
+    if constexpr (node_allocator_traits::propagate_on_container_move_assignment::value) m_alloc = other.m_alloc;
+    m_comp = other.m_comp;
+
+    if (m_alloc == other.m_alloc) take_tree(other);
+    else
+    {
+        for (auto& key : other) insert(std::move(key));
+        other.clear();
+    }
+    return *this;
 }
 
-template< class Key >
-inline set<Key>& set<Key>::operator=( std::initializer_list<value_type> ilist )
+template< class Key, class Compare, class Allocator, class Augment >
+inline set<Key, Compare, Allocator, Augment>& set<Key, Compare, Allocator, Augment>::operator=( std::initializer_list<value_type> ilist )
 {
-    for (const auto& it : ilist) insert(it); 
+    clear();
+    assign_range(ilist.begin(), ilist.end());
+    return *this;
 }
 
 
+// set of closed intervals with overlap and stabbing queries
+template< class T, class Allocator = std::allocator<interval<T>> >
+using interval_set = set<interval<T>, std::less<interval<T>>, Allocator, interval_max<T>>;
+
 
 #endif //!_OWN_SET_HPP_
\ No newline at end of file
@@ -0,0 +1,565 @@
+#ifndef _UNORDERED_FLAT_SET_HPP_
+#define _UNORDERED_FLAT_SET_HPP_
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+// Open-addressing hash set in the Swiss table style: keys sit inline in one slot
+// array, and a parallel array of control bytes holds 7 bits of each key's hash
+// or marks the slot empty. A lookup compares 16 control bytes at once (SSE2,
+// or a portable loop elsewhere) and touches a key only on a 7-bit match.
+//
+// Probing is linear from the key's home slot and never wraps: a tail of spare
+// slots past the last home absorbs clusters at the end. A cluster that runs
+// through the tail doubles the tail, not the table, so keys piling onto the
+// last homes (colliding hashes included) cost memory linear in their number;
+// only the load factor doubles the table. Without wrap-around erase can shift
+// the rest of the cluster back (backward-shift deletion), so there are no
+// tombstones, lookups stop at the first empty slot and the table never
+// degrades under churn. Iteration follows slot order; erase(pos) may move a
+// later key into pos.
+template< class Key, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>, class Allocator = std::allocator<Key> >
+class unordered_flat_set
+{
+private:
+    class slot_iter;
+    struct slot;
+
+public:
+    using key_type = Key;
+    using value_type = Key;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = KeyEqual;
+    using allocator_type = Allocator;
+    using reference = const Key&;
+    using const_reference = const Key&;
+    using iterator = slot_iter;
+    using const_iterator = slot_iter;
+
+    static constexpr size_t group_width = 16;
+
+public:
+    // constructors and destructor
+    unordered_flat_set() = default;
+    explicit unordered_flat_set( size_type bucket_count, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator() )
+        : m_hash(hash), m_equal(equal), m_alloc(alloc) { reserve(bucket_count); }
+    template< std::input_iterator InputIt >
+    unordered_flat_set( InputIt first, InputIt last, size_type bucket_count = 0, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator() )
+        : unordered_flat_set(bucket_count, hash, equal, alloc) { insert(first, last); }
+    unordered_flat_set( std::initializer_list<Key> init, size_type bucket_count = 0, const Hash& hash = Hash(), const KeyEqual& equal = KeyEqual(), const Allocator& alloc = Allocator() )
+        : unordered_flat_set(init.begin(), init.end(), bucket_count, hash, equal, alloc) {}
+    unordered_flat_set( const unordered_flat_set& other );
+    unordered_flat_set( unordered_flat_set&& other ) noexcept;
+    ~unordered_flat_set() { destroy_all(); }
+
+    // assignment operators
+    unordered_flat_set& operator=( const unordered_flat_set& other );
+    unordered_flat_set& operator=( unordered_flat_set&& other ) noexcept;
+
+    allocator_type get_allocator() const noexcept { return allocator_type(m_alloc); }
+
+    // iterators
+    iterator begin() const { return iterator(this, next_full(0)); }
+    iterator cbegin() const { return begin(); }
+    iterator end() const { return iterator(this, slot_count()); }
+    iterator cend() const { return end(); }
+
+    // capacity
+    [[nodiscard]] bool empty() const noexcept { return m_size == 0; }
+    size_type size() const noexcept { return m_size; }
+
+    // modifiers
+    void clear() noexcept;
+
+    std::pair<iterator, bool> insert( const value_type& key ) { return emplace_key(key); }
+    std::pair<iterator, bool> insert( value_type&& key ) { return emplace_key(std::move(key)); }
+    template< std::input_iterator InputIt >
+    void insert( InputIt first, InputIt last ) { for (; first != last; ++first) insert(*first); }
+    template< class... Args >
+    std::pair<iterator, bool> emplace( Args&&... args ) { return emplace_key(Key(std::forward<Args>(args)...)); }
+
+    iterator erase( const_iterator pos );
+    size_type erase( const key_type& key );
+
+    void swap( unordered_flat_set& other ) noexcept;
+
+    // lookup
+    iterator find( const key_type& key ) const { return iterator(this, find_index(key)); }
+    bool contains( const key_type& key ) const { return find_index(key) != slot_count(); }
+    size_type count( const key_type& key ) const { return contains(key) ? 1 : 0; }
+
+    // hash policy; bucket_count is the number of home slots, a power of two
+    size_type bucket_count() const noexcept { return m_capacity; }
+    float load_factor() const noexcept { return m_capacity == 0 ? 0.0f : float(m_size) / float(m_capacity); }
+    float max_load_factor() const noexcept { return m_max_load; }
+    void max_load_factor( float ml );
+    void rehash( size_type count );
+    void reserve( size_type count ) { rehash(static_cast<size_type>(std::ceil(count / double(m_max_load)))); }
+
+    // observers
+    hasher hash_function() const { return m_hash; }
+    key_equal key_eq() const { return m_equal; }
+
+private:
+    using ctrl_t = std::uint8_t;
+
+    // empty slots have the top bit set, full ones hold the low 7 hash bits
+    static constexpr ctrl_t empty_ctrl = 0x80;
+    // spare slots past the last home slot, room for the clusters at the end
+    static constexpr size_t min_tail_slots = 32;
+
+    struct slot
+    {
+        union { Key key; };
+
+        slot() {}
+        ~slot() {}
+    };
+
+    // 16 control bytes, answers as bit masks with bit i for byte i
+    struct group
+    {
+#if defined(__SSE2__)
+        __m128i bytes;
+
+        explicit group( const ctrl_t* ctrl ) : bytes(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+        std::uint32_t match( ctrl_t h2 ) const { return static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(h2))))); }
+        std::uint32_t match_empty() const { return static_cast<std::uint32_t>(_mm_movemask_epi8(bytes)); }
+#else
+        ctrl_t bytes[group_width];
+
+        explicit group( const ctrl_t* ctrl ) { std::memcpy(bytes, ctrl, group_width); }
+
+        std::uint32_t match( ctrl_t h2 ) const
+        {
+            std::uint32_t mask = 0;
+            for (size_t i = 0; i < group_width; ++i) mask |= std::uint32_t(bytes[i] == h2) << i;
+            return mask;
+        }
+        std::uint32_t match_empty() const
+        {
+            std::uint32_t mask = 0;
+            for (size_t i = 0; i < group_width; ++i) mask |= std::uint32_t(bytes[i] >> 7) << i;
+            return mask;
+        }
+#endif
+        std::uint32_t match_full() const { return ~match_empty() & ((1u << group_width) - 1); }
+    };
+
+    class slot_iter
+    {
+    private:
+        friend class unordered_flat_set;
+
+    public:
+        using value_type = Key;
+        using difference_type = std::ptrdiff_t;
+        using reference = const Key&;
+        using pointer = const Key*;
+        using iterator_category = std::forward_iterator_tag;
+
+    private:
+        slot_iter( const unordered_flat_set* owner, size_t index ) : m_owner(owner), m_index(index) {}
+
+        const unordered_flat_set* m_owner = nullptr;
+        size_t m_index = 0;
+
+    public:
+        slot_iter() = default;
+
+        reference operator * () const noexcept { return m_owner->m_slots[m_index].key; }
+        pointer operator -> () const noexcept { return &m_owner->m_slots[m_index].key; }
+
+        slot_iter& operator ++ () { m_index = m_owner->next_full(m_index + 1); return *this; }
+        slot_iter operator ++ (int) { slot_iter tmp = *this; ++(*this); return tmp; }
+
+        bool operator == ( const slot_iter& other ) const noexcept { return m_index == other.m_index; }
+        bool operator != ( const slot_iter& other ) const noexcept { return m_index != other.m_index; }
+    };
+
+    size_t slot_count() const noexcept { return m_capacity + m_tail; }
+    // the control array is padded with empty bytes so a group can be read from any slot
+    size_t ctrl_count() const noexcept { return slot_count() + group_width; }
+
+    // std::hash of an integer is often the identity, spread it over all 64 bits
+    std::uint64_t mixed_hash( const Key& key ) const
+    {
+        std::uint64_t h = static_cast<std::uint64_t>(m_hash(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+    size_t home( std::uint64_t h ) const noexcept { return static_cast<size_t>(h >> 7) & (m_capacity - 1); }
+    static ctrl_t h2( std::uint64_t h ) noexcept { return static_cast<ctrl_t>(h & 0x7f); }
+
+    size_t next_full( size_t index ) const;
+    size_t find_index( const key_type& key ) const;
+
+    template< class K >
+    std::pair<iterator, bool> emplace_key( K&& key );
+    // first empty slot at or after index, which may lie past the last slot
+    static size_t first_empty( const ctrl_t* ctrl, size_t index );
+
+    void erase_index( size_t index );
+    void resize( size_t capacity, size_t tail );
+    void allocate_table( size_t capacity, size_t tail );
+    // count is capacity + tail of the table being freed
+    void deallocate_table( slot* slots, ctrl_t* ctrl, size_t count ) noexcept;
+    void destroy_all() noexcept;
+
+    using slot_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<slot>;
+    using slot_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<slot>;
+    using ctrl_allocator = typename std::allocator_traits<Allocator>::template rebind_alloc<ctrl_t>;
+    using ctrl_allocator_traits = typename std::allocator_traits<Allocator>::template rebind_traits<ctrl_t>;
+
+    slot* m_slots = nullptr;
+    ctrl_t* m_ctrl = nullptr;
+    size_t m_capacity = 0;
+    size_t m_tail = 0;
+    size_t m_size = 0;
+    size_t m_growth_left = 0;
+    float m_max_load = 0.875f;
+    [[no_unique_address]] Hash m_hash;
+    [[no_unique_address]] KeyEqual m_equal;
+    [[no_unique_address]] slot_allocator m_alloc;
+};
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline unordered_flat_set<Key, Hash, KeyEqual, Allocator>::unordered_flat_set( const unordered_flat_set& other )
+    : m_max_load(other.m_max_load), m_hash(other.m_hash), m_equal(other.m_equal),
+      m_alloc(slot_allocator_traits::select_on_container_copy_construction(other.m_alloc))
+{
+    if (other.m_capacity == 0) return;
+
+    // same capacity, same hash: every key goes to the slot it had
+    allocate_table(other.m_capacity, other.m_tail);
+    for (size_t i = other.next_full(0); i < other.slot_count(); i = other.next_full(i + 1))
+    {
+        slot_allocator_traits::construct(m_alloc, &m_slots[i].key, other.m_slots[i].key);
+        m_ctrl[i] = other.m_ctrl[i];
+        ++m_size;
+        --m_growth_left;
+    }
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline unordered_flat_set<Key, Hash, KeyEqual, Allocator>::unordered_flat_set( unordered_flat_set&& other ) noexcept
+    : m_slots(std::exchange(other.m_slots, nullptr)), m_ctrl(std::exchange(other.m_ctrl, nullptr)),
+      m_capacity(std::exchange(other.m_capacity, 0)), m_tail(std::exchange(other.m_tail, 0)), m_size(std::exchange(other.m_size, 0)),
+      m_growth_left(std::exchange(other.m_growth_left, 0)), m_max_load(other.m_max_load),
+      m_hash(other.m_hash), m_equal(other.m_equal), m_alloc(std::move(other.m_alloc)) {}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline unordered_flat_set<Key, Hash, KeyEqual, Allocator>& unordered_flat_set<Key, Hash, KeyEqual, Allocator>::operator=( const unordered_flat_set& other )
+{
+    if (this == &other) return *this;
+
+    unordered_flat_set copy(other);
+    swap(copy);
+    return *this;
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline unordered_flat_set<Key, Hash, KeyEqual, Allocator>& unordered_flat_set<Key, Hash, KeyEqual, Allocator>::operator=( unordered_flat_set&& other ) noexcept
+{
+    if (this == &other) return *this;
+
+    destroy_all();
+    swap(other);
+    return *this;
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::clear() noexcept
+{
+    if (m_capacity == 0) return;
+
+    for (size_t i = next_full(0); i < slot_count(); i = next_full(i + 1))
+        slot_allocator_traits::destroy(m_alloc, &m_slots[i].key);
+
+    std::memset(m_ctrl, empty_ctrl, ctrl_count());
+    m_size = 0;
+    m_growth_left = static_cast<size_t>(m_capacity * m_max_load);
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline unordered_flat_set<Key, Hash, KeyEqual, Allocator>::iterator unordered_flat_set<Key, Hash, KeyEqual, Allocator>::erase( const_iterator pos )
+{
+    size_t index = pos.m_index;
+    erase_index(index);
+
+    // a later key of the cluster may have been shifted into index, it is next
+    return iterator(this, next_full(index));
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline unordered_flat_set<Key, Hash, KeyEqual, Allocator>::size_type unordered_flat_set<Key, Hash, KeyEqual, Allocator>::erase( const key_type& key )
+{
+    size_t index = find_index(key);
+    if (index == slot_count()) return 0;
+
+    erase_index(index);
+    return 1;
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::swap( unordered_flat_set& other ) noexcept
+{
+    std::swap(m_slots, other.m_slots);
+    std::swap(m_ctrl, other.m_ctrl);
+    std::swap(m_capacity, other.m_capacity);
+    std::swap(m_tail, other.m_tail);
+    std::swap(m_size, other.m_size);
+    std::swap(m_growth_left, other.m_growth_left);
+    std::swap(m_max_load, other.m_max_load);
+    std::swap(m_hash, other.m_hash);
+    std::swap(m_equal, other.m_equal);
+    std::swap(m_alloc, other.m_alloc);
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::max_load_factor( float ml )
+{
+    if (!(ml > 0.0f && ml <= 0.95f)) throw std::invalid_argument("unordered_flat_set: max load factor must be in (0, 0.95]");
+
+    m_max_load = ml;
+    if (m_size > m_capacity * ml) rehash(0);
+    else m_growth_left = static_cast<size_t>(m_capacity * ml) - m_size;
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::rehash( size_type count )
+{
+    // never below what the current keys need at the maximum load
+    size_t needed = std::max<size_t>(count, static_cast<size_t>(std::ceil(m_size / double(m_max_load))));
+    if (needed == 0) return;
+
+    // and always room for one more key: at a small maximum load the smallest
+    // table may not hold a single one, and the next insert must not find none
+    size_t capacity = std::bit_ceil(std::max<size_t>(needed, group_width));
+    while (static_cast<size_t>(capacity * m_max_load) <= m_size) capacity *= 2;
+    if (capacity != m_capacity) resize(capacity, min_tail_slots);
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline size_t unordered_flat_set<Key, Hash, KeyEqual, Allocator>::next_full( size_t index ) const
+{
+    size_t end = slot_count();
+    while (index < end)
+    {
+        // padding bytes past the last slot read as empty
+        if (std::uint32_t full = group(m_ctrl + index).match_full())
+            return std::min(end, index + std::countr_zero(full));
+        index += group_width;
+    }
+    return end;
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline size_t unordered_flat_set<Key, Hash, KeyEqual, Allocator>::find_index( const key_type& key ) const
+{
+    if (m_size == 0) return slot_count();
+
+    std::uint64_t h = mixed_hash(key);
+    ctrl_t tag = h2(h);
+    for (size_t index = home(h); ; index += group_width)
+    {
+        group g(m_ctrl + index);
+        for (std::uint32_t match = g.match(tag); match != 0; match &= match - 1)
+        {
+            size_t candidate = index + std::countr_zero(match);
+            if (m_equal(m_slots[candidate].key, key)) return candidate;
+        }
+
+        // clusters hold no gaps, the first empty slot ends the search
+        if (g.match_empty() != 0) return slot_count();
+    }
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+template< class K >
+inline std::pair<typename unordered_flat_set<Key, Hash, KeyEqual, Allocator>::iterator, bool> unordered_flat_set<Key, Hash, KeyEqual, Allocator>::emplace_key( K&& key )
+{
+    size_t found = find_index(key);
+    if (found != slot_count()) return std::make_pair(iterator(this, found), false);
+
+    if (m_growth_left == 0) rehash(std::max<size_t>(m_capacity * 2, group_width));
+    if (m_growth_left == 0) throw std::length_error("unordered_flat_set: table cannot grow");
+
+    // a cluster that would run off the tail grows the tail
+    std::uint64_t h = mixed_hash(key);
+    size_t index = first_empty(m_ctrl, home(h));
+    while (index >= slot_count())
+    {
+        resize(m_capacity, m_tail * 2);
+        index = first_empty(m_ctrl, home(h));
+    }
+
+    slot_allocator_traits::construct(m_alloc, &m_slots[index].key, std::forward<K>(key));
+    m_ctrl[index] = h2(h);
+    ++m_size;
+    --m_growth_left;
+    return std::make_pair(iterator(this, index), true);
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline size_t unordered_flat_set<Key, Hash, KeyEqual, Allocator>::first_empty( const ctrl_t* ctrl, size_t index )
+{
+    // the padding bytes are empty, so this stops within one group of the end
+    while (true)
+    {
+        if (std::uint32_t empty = group(ctrl + index).match_empty())
+            return index + std::countr_zero(empty);
+        index += group_width;
+    }
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::erase_index( size_t index )
+{
+    slot_allocator_traits::destroy(m_alloc, &m_slots[index].key);
+
+    // pull back every later key of the cluster whose home is at or before the gap
+    for (size_t next = index + 1; m_ctrl[next] != empty_ctrl; ++next)
+    {
+        if (home(mixed_hash(m_slots[next].key)) > index) continue;
+
+        slot_allocator_traits::construct(m_alloc, &m_slots[index].key, std::move(m_slots[next].key));
+        slot_allocator_traits::destroy(m_alloc, &m_slots[next].key);
+        m_ctrl[index] = m_ctrl[next];
+        index = next;
+    }
+
+    m_ctrl[index] = empty_ctrl;
+    --m_size;
+    ++m_growth_left;
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::resize( size_t capacity, size_t tail )
+{
+    slot* old_slots = m_slots;
+    ctrl_t* old_ctrl = m_ctrl;
+    size_t old_capacity = m_capacity;
+    size_t old_tail = m_tail;
+    size_t old_count = slot_count();
+    size_t old_growth_left = m_growth_left;
+    size_t size = m_size;
+
+    // place the control bytes first and move the keys once all of them fit: a
+    // cluster can still run off the end of the new table, whose tail then grows
+    std::vector<size_t> target(old_count);
+    while (true)
+    {
+        m_slots = nullptr;
+        try
+        {
+            allocate_table(capacity, tail);
+
+            bool placed = true;
+            for (size_t i = 0; i < old_count && placed; ++i)
+            {
+                if (old_ctrl[i] == empty_ctrl) continue;
+
+                target[i] = first_empty(m_ctrl, home(mixed_hash(old_slots[i].key)));
+                placed = target[i] < slot_count();
+                if (placed) m_ctrl[target[i]] = old_ctrl[i];
+            }
+            if (placed) break;
+        }
+        catch (...)
+        {
+            if (m_slots != nullptr) deallocate_table(m_slots, m_ctrl, capacity + tail);
+            m_slots = old_slots;
+            m_ctrl = old_ctrl;
+            m_capacity = old_capacity;
+            m_tail = old_tail;
+            m_growth_left = old_growth_left;
+            throw;
+        }
+
+        deallocate_table(m_slots, m_ctrl, capacity + tail);
+        tail *= 2;
+    }
+
+    for (size_t i = 0; i < old_count; ++i)
+    {
+        if (old_ctrl[i] == empty_ctrl) continue;
+
+        slot_allocator_traits::construct(m_alloc, &m_slots[target[i]].key, std::move(old_slots[i].key));
+        slot_allocator_traits::destroy(m_alloc, &old_slots[i].key);
+    }
+    m_growth_left -= size;
+
+    if (old_slots != nullptr) deallocate_table(old_slots, old_ctrl, old_capacity + old_tail);
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::allocate_table( size_t capacity, size_t tail )
+{
+    slot* slots = slot_allocator_traits::allocate(m_alloc, capacity + tail);
+
+    ctrl_allocator ctrl_alloc(m_alloc);
+    try
+    {
+        m_ctrl = ctrl_allocator_traits::allocate(ctrl_alloc, capacity + tail + group_width);
+    }
+    catch (...)
+    {
+        slot_allocator_traits::deallocate(m_alloc, slots, capacity + tail);
+        throw;
+    }
+
+    m_slots = slots;
+    m_capacity = capacity;
+    m_tail = tail;
+    std::memset(m_ctrl, empty_ctrl, ctrl_count());
+    m_growth_left = static_cast<size_t>(capacity * m_max_load);
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::deallocate_table( slot* slots, ctrl_t* ctrl, size_t count ) noexcept
+{
+    slot_allocator_traits::deallocate(m_alloc, slots, count);
+    ctrl_allocator ctrl_alloc(m_alloc);
+    ctrl_allocator_traits::deallocate(ctrl_alloc, ctrl, count + group_width);
+}
+
+template< class Key, class Hash, class KeyEqual, class Allocator >
+inline void unordered_flat_set<Key, Hash, KeyEqual, Allocator>::destroy_all() noexcept
+{
+    if (m_capacity == 0) return;
+
+    clear();
+    deallocate_table(m_slots, m_ctrl, slot_count());
+
+    m_slots = nullptr;
+    m_ctrl = nullptr;
+    m_capacity = 0;
+    m_tail = 0;
+    m_growth_left = 0;
+}
+
+#endif // !_UNORDERED_FLAT_SET_HPP_
@@ -0,0 +1,183 @@
+#ifndef _EPOCH_DOMAIN_HPP_
+#define _EPOCH_DOMAIN_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// Epoch based memory reclamation for the lock-free containers.
+// A thread pins the domain for the length of one operation. Objects unlinked
+// while pinned are retired with the current global epoch and handed to their
+// reclaim function once the epoch has advanced twice, i.e. once every thread
+// that could still see them has unpinned. The global epoch advances only when
+// all pinned threads have observed it.
+//
+// Each domain is owned by one container. Pinning claims one of max_slots slots,
+// starting from a slot chosen by the thread id, so no thread registration is
+// needed. Retired objects are kept in the slot they were retired from; the slot
+// owner of a later pin reclaims them, and the domain destructor reclaims whatever
+// is left.
+class epoch_domain
+{
+public:
+    using reclaim_fn = void (*)( void* object, void* context );
+
+    static constexpr size_t max_slots = 64;
+
+private:
+    struct retired
+    {
+        void* object;
+        reclaim_fn reclaim;
+        void* context;
+    };
+
+    struct alignas(64) slot
+    {
+        // (epoch << 1) | 1 while pinned, 0 while free
+        std::atomic<std::uint64_t> state{ 0 };
+
+        std::vector<retired> bags[3];
+        std::uint64_t bag_epoch[3] = { 0, 0, 0 };
+        unsigned pins = 0;
+    };
+
+public:
+    class guard
+    {
+    private:
+        friend class epoch_domain;
+
+        guard( epoch_domain* domain, slot* owned ) : m_domain(domain), m_slot(owned) {}
+
+        epoch_domain* m_domain;
+        slot* m_slot;
+
+    public:
+        guard( const guard& ) = delete;
+        guard& operator=( const guard& ) = delete;
+        guard( guard&& other ) noexcept : m_domain(other.m_domain), m_slot(std::exchange(other.m_slot, nullptr)) {}
+        guard& operator=( guard&& other ) noexcept
+        {
+            if (this != &other)
+            {
+                if (m_slot) m_domain->unpin(m_slot);
+                m_domain = other.m_domain;
+                m_slot = std::exchange(other.m_slot, nullptr);
+            }
+            return *this;
+        }
+        ~guard() { if (m_slot) m_domain->unpin(m_slot); }
+
+        // object must already be unreachable for threads that pin after this call
+        void retire( void* object, reclaim_fn reclaim, void* context = nullptr )
+        {
+            m_domain->retire(m_slot, retired{ object, reclaim, context });
+        }
+    };
+
+public:
+    epoch_domain() = default;
+    epoch_domain( const epoch_domain& ) = delete;
+    epoch_domain& operator=( const epoch_domain& ) = delete;
+    ~epoch_domain() { reclaim_all(); }
+
+    guard pin();
+
+    // reclaims every retired object, only valid while no thread is pinned
+    void reclaim_all();
+
+private:
+    void unpin( slot* owned ) { owned->state.store(0, std::memory_order_release); }
+    void retire( slot* owned, retired r );
+
+    bool try_advance( std::uint64_t epoch );
+    void collect( slot* owned, std::uint64_t epoch );
+
+    static void flush( std::vector<retired>& bag );
+
+    std::atomic<std::uint64_t> m_epoch{ 2 };
+    slot m_slots[max_slots];
+};
+
+inline epoch_domain::guard epoch_domain::pin()
+{
+    size_t index = std::hash<std::thread::id>()(std::this_thread::get_id()) % max_slots;
+
+    while (true)
+    {
+        std::uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+        std::uint64_t expected = 0;
+
+        if (m_slots[index].state.compare_exchange_strong(expected, (epoch << 1) | 1, std::memory_order_seq_cst))
+        {
+            slot* owned = &m_slots[index];
+
+            // amortise the scan over all slots
+            if ((++owned->pins & 63) == 0 && try_advance(epoch)) ++epoch;
+            collect(owned, epoch);
+
+            return guard(this, owned);
+        }
+
+        index = (index + 1) % max_slots;
+        if (index == 0) std::this_thread::yield();
+    }
+}
+
+inline void epoch_domain::retire( slot* owned, retired r )
+{
+    std::uint64_t epoch = m_epoch.load(std::memory_order_seq_cst);
+    size_t bag = epoch % 3;
+
+    // a bag is reused three epochs later, by then its contents are safe to free
+    if (owned->bag_epoch[bag] != epoch)
+    {
+        flush(owned->bags[bag]);
+        owned->bag_epoch[bag] = epoch;
+    }
+    owned->bags[bag].push_back(r);
+
+    if (owned->bags[bag].size() >= 128) try_advance(epoch);
+}
+
+inline bool epoch_domain::try_advance( std::uint64_t epoch )
+{
+    for (slot& s : m_slots)
+    {
+        std::uint64_t state = s.state.load(std::memory_order_seq_cst);
+        if ((state & 1) && (state >> 1) != epoch) return false;
+    }
+
+    return m_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+inline void epoch_domain::collect( slot* owned, std::uint64_t epoch )
+{
+    std::uint64_t current = m_epoch.load(std::memory_order_seq_cst);
+    if (current > epoch) epoch = current;
+
+    for (size_t bag = 0; bag < 3; ++bag)
+    {
+        if (!owned->bags[bag].empty() && owned->bag_epoch[bag] + 2 <= epoch) flush(owned->bags[bag]);
+    }
+}
+
+inline void epoch_domain::flush( std::vector<retired>& bag )
+{
+    for (const retired& r : bag) r.reclaim(r.object, r.context);
+    bag.clear();
+}
+
+inline void epoch_domain::reclaim_all()
+{
+    for (slot& s : m_slots)
+        for (auto& bag : s.bags) flush(bag);
+}
+
+#endif // !_EPOCH_DOMAIN_HPP_
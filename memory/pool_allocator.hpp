@@ -0,0 +1,178 @@
+#ifndef _POOL_ALLOCATOR_HPP_
+#define _POOL_ALLOCATOR_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+
+// Fixed-size block pool for node based containers.
+// Small requests are rounded up to a size class and served from per-class free
+// lists, refilled by bumping through large chunks taken from the global heap.
+// Freed blocks go back to their free list, the chunks themselves are returned
+// only when the resource dies. Not thread safe: share a resource between
+// containers used by one thread only.
+class pool_resource
+{
+public:
+    static constexpr size_t alignment = alignof(std::max_align_t);
+    static constexpr size_t max_pooled_size = 512;
+    static constexpr size_t default_chunk_size = 64 * 1024;
+
+public:
+    explicit pool_resource( size_t chunk_size = default_chunk_size ) : m_chunk_size(chunk_size) {}
+    pool_resource( const pool_resource& ) = delete;
+    pool_resource& operator=( const pool_resource& ) = delete;
+    ~pool_resource() { release(); }
+
+    void* allocate( size_t bytes, size_t align = alignment );
+    void deallocate( void* p, size_t bytes, size_t align = alignment ) noexcept;
+
+    // returns every chunk to the heap at once, blocks handed out become invalid
+    void release() noexcept;
+
+    size_t chunk_count() const noexcept { return m_chunk_count; }
+
+private:
+    struct free_block { free_block* next; };
+    struct chunk { chunk* next; };
+
+    static constexpr size_t class_count = max_pooled_size / alignment;
+    static constexpr size_t chunk_header = (sizeof(chunk) + alignment - 1) / alignment * alignment;
+
+    static bool pooled( size_t bytes, size_t align ) noexcept { return bytes <= max_pooled_size && align <= alignment; }
+    static size_t size_class( size_t bytes ) noexcept { return bytes == 0 ? 0 : (bytes - 1) / alignment; }
+
+    void* refill( size_t block_size );
+
+    free_block* m_free[class_count] = {};
+    chunk* m_chunks = nullptr;
+    char* m_cursor = nullptr;
+    char* m_end = nullptr;
+    size_t m_chunk_size;
+    size_t m_chunk_count = 0;
+};
+
+inline void* pool_resource::allocate( size_t bytes, size_t align )
+{
+    if (!pooled(bytes, align)) return ::operator new(bytes, std::align_val_t(align));
+
+    size_t cls = size_class(bytes);
+    if (free_block* block = m_free[cls])
+    {
+        m_free[cls] = block->next;
+        return block;
+    }
+    return refill((cls + 1) * alignment);
+}
+
+inline void pool_resource::deallocate( void* p, size_t bytes, size_t align ) noexcept
+{
+    if (!pooled(bytes, align))
+    {
+        ::operator delete(p, std::align_val_t(align));
+        return;
+    }
+
+    size_t cls = size_class(bytes);
+    free_block* block = static_cast<free_block*>(p);
+    block->next = m_free[cls];
+    m_free[cls] = block;
+}
+
+inline void* pool_resource::refill( size_t block_size )
+{
+    if (static_cast<size_t>(m_end - m_cursor) < block_size)
+    {
+        size_t size = m_chunk_size < chunk_header + block_size ? chunk_header + block_size : m_chunk_size;
+        char* memory = static_cast<char*>(::operator new(size, std::align_val_t(alignment)));
+
+        chunk* fresh = reinterpret_cast<chunk*>(memory);
+        fresh->next = m_chunks;
+        m_chunks = fresh;
+        ++m_chunk_count;
+
+        m_cursor = memory + chunk_header;
+        m_end = memory + size;
+    }
+
+    void* block = m_cursor;
+    m_cursor += block_size;
+    return block;
+}
+
+inline void pool_resource::release() noexcept
+{
+    while (m_chunks != nullptr)
+    {
+        chunk* next = m_chunks->next;
+        ::operator delete(static_cast<void*>(m_chunks), std::align_val_t(alignment));
+        m_chunks = next;
+    }
+
+    for (auto& head : m_free) head = nullptr;
+    m_cursor = m_end = nullptr;
+    m_chunk_count = 0;
+}
+
+
+// Allocator handle over a shared pool_resource. Copies and rebound copies
+// share the resource and compare equal, so a container's node allocator and
+// the allocator it was built from draw from the same pool. A default
+// constructed allocator creates a resource of its own.
+template< class T >
+class pool_allocator
+{
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using difference_type = std::ptrdiff_t;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+public:
+    pool_allocator() : m_resource(std::make_shared<pool_resource>()) {}
+    explicit pool_allocator( std::shared_ptr<pool_resource> resource ) noexcept : m_resource(std::move(resource)) {}
+
+    template< class U >
+    pool_allocator( const pool_allocator<U>& other ) noexcept : m_resource(other.m_resource) {}
+
+    T* allocate( size_type n )
+    {
+        return static_cast<T*>(m_resource->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate( T* p, size_type n ) noexcept
+    {
+        m_resource->deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    pool_resource* resource() const noexcept { return m_resource.get(); }
+
+    // drops every chunk in O(1) when no other handle shares the resource, for a
+    // container tearing down nodes that need no destructor; false otherwise
+    bool release_if_sole_owner() noexcept
+    {
+        if (m_resource.use_count() != 1) return false;
+
+        m_resource->release();
+        return true;
+    }
+
+    template< class U >
+    bool operator == ( const pool_allocator<U>& other ) const noexcept { return m_resource == other.m_resource; }
+    template< class U >
+    bool operator != ( const pool_allocator<U>& other ) const noexcept { return m_resource != other.m_resource; }
+
+private:
+    template< class U >
+    friend class pool_allocator;
+
+    std::shared_ptr<pool_resource> m_resource;
+};
+
+#endif // !_POOL_ALLOCATOR_HPP_